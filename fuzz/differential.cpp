@@ -0,0 +1,574 @@
+// Differential test driver: generates random and adversarial documents together with the tree
+// they must parse to, runs them through every parse path and compares trees and serializations.
+// Throughput of every path is reported so that speed regressions show up next to wrong results.
+//
+//   g++ -std=c++17 -O2 -pthread fuzz/differential.cpp json/json.cpp -o differential
+//   ./differential [documents] [seed] [--record bench_output.txt]
+//
+// Exits with 1 if any path disagrees, --record appends the throughput lines to a file.
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <random>
+#include <set>
+#include <stdexcept>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../json/json.h"
+#include "supported.h"
+
+namespace {
+    class Generator {
+    public:
+        Generator(unsigned seed, bool adversarial) :
+            m_random(seed), m_adversarial(adversarial)
+        {
+        }
+
+        // returns the tree the text must parse to, nullptr if the text is valid JSON the parser
+        // must reject (see fuzz::is_supported), only the adversarial corpus has those
+        std::unique_ptr<json::JSON> document(std::string& text) {
+            static const std::vector<std::string> roots = { "[]", "[{}]", "\"root\"", "12", "null" };
+            auto expected = std::make_unique<json::JSON>();
+            this->m_unsupported = false;
+
+            text += this->whitespace();
+            if (this->m_adversarial && this->below(50) == 0) {
+                text += roots[this->below(roots.size())];
+                this->m_unsupported = true;
+            }
+            else {
+                this->object(*expected, text, 0);
+            }
+            text += this->whitespace();
+
+            return this->m_unsupported ? nullptr : std::move(expected);
+        }
+
+    private:
+        size_t below(size_t n) {
+            return std::uniform_int_distribution<size_t>(0, n - 1)(this->m_random);
+        }
+
+        std::string whitespace() {
+            static const char* chars = " \t\r\n";
+
+            if (!this->m_adversarial) {
+                return this->below(2) ? " " : "";
+            }
+
+            std::string ws;
+            for (size_t n = this->below(4); n > 0; n--) {
+                ws += chars[this->below(4)];
+            }
+            return ws;
+        }
+
+        // raw string content, the parser keeps escapes as they are written
+        std::string string_content(bool key) {
+            static const std::string plain = "abcdefghijklmnopqrstuvwxyz0123456789_ ";
+            static const std::vector<std::string> special = {
+                ",", ":", "{", "}", "[", "]", "(", ")", ".", "\\\"", "\\\\", "\\n", "\\u00e9", "\xc3\xa9", "\xe2\x82\xac"
+            };
+
+            std::string content;
+            size_t length = key && !this->m_adversarial ? 1 + this->below(8) : this->below(12);
+
+            for (size_t i = 0; i < length; i++) {
+                if (this->m_adversarial && this->below(4) == 0) {
+                    content += special[this->below(special.size())];
+                    continue;
+                }
+
+                content += plain[this->below(key && !this->m_adversarial ? plain.size() - 1 : plain.size())];
+            }
+
+            return content;
+        }
+
+        size_t members(size_t depth) {
+            return depth < 3 ? this->below(6) : this->below(3);
+        }
+
+        bool container(size_t depth) {
+            size_t max_depth = this->m_adversarial ? 24 : 6;
+            return depth < max_depth && this->below(depth < 2 ? 3 : 2) == 0;
+        }
+
+        void object(json::JSON& out, std::string& text, size_t depth) {
+            std::set<std::string> keys;
+            text += "{";
+
+            for (size_t n = this->members(depth), i = 0; i < n; i++) {
+                std::string key = this->string_content(true);
+                if (!keys.insert(key).second) {
+                    continue;
+                }
+
+                if (keys.size() > 1) {
+                    text += this->whitespace() + ",";
+                }
+
+                text += this->whitespace() + "\"" + key + "\"" + this->whitespace() + ":" + this->whitespace();
+                this->value(out[key], text, depth + 1, false);
+            }
+
+            text += this->whitespace() + "}";
+        }
+
+        // valid JSON the tree can't hold
+        void unsupported(std::string& text, bool in_list) {
+            static const std::vector<std::string> values = {
+                "true", "false", "null", "2147483648", "-2147483649", "1e999", "-1E400"
+            };
+
+            if (in_list && this->below(3) == 0) {
+                text += "[" + this->whitespace() + (this->below(2) ? "1" : "") + "]";
+            }
+            else {
+                text += values[this->below(values.size())];
+            }
+
+            this->m_unsupported = true;
+        }
+
+        void value(json::Value& out, std::string& text, size_t depth, bool in_list) {
+            if (this->m_adversarial && this->below(200) == 0) {
+                this->unsupported(text, in_list);
+                return;
+            }
+
+            // lists of lists are not supported by the parser
+            size_t kind = this->container(depth) ? 3 + this->below(in_list ? 1 : 2) : this->below(3);
+
+            switch (kind) {
+                case 0: {
+                    int value = this->m_adversarial
+                        ? std::uniform_int_distribution<int>(INT_MIN, INT_MAX)(this->m_random)
+                        : static_cast<int>(this->below(2000001)) - 1000000;
+                    text += std::to_string(value);
+                    out = json::ValuePair{ new int(value), json::ValueType::INTEGER };
+                    break;
+                }
+
+                case 1: {
+                    // short fractions in the random corpus, any magnitude and exponents in the adversarial one
+                    static const std::vector<std::string> fractions = { ".5", ".25", ".75", ".125" };
+                    std::string number;
+
+                    if (this->m_adversarial) {
+                        double value = std::uniform_real_distribution<double>(-1, 1)(this->m_random) * std::pow(10.0, int(this->below(41)) - 20);
+                        char buffer[32];
+                        auto format = this->below(2) ? std::chars_format::scientific : std::chars_format::general;
+                        number.assign(buffer, std::to_chars(buffer, buffer + sizeof(buffer), value, format).ptr);
+
+                        if (number.find_first_of(".e") == std::string::npos) {
+                            number += ".0";
+                        }
+                        if (this->below(2)) {
+                            std::replace(number.begin(), number.end(), 'e', 'E');
+                        }
+                    }
+                    else {
+                        number = (this->below(2) ? "-" : "") + std::to_string(this->below(1000)) + fractions[this->below(4)];
+                    }
+
+                    double value = 0;
+                    std::from_chars(number.data(), number.data() + number.size(), value);
+                    text += number;
+                    out = json::ValuePair{ new double(value), json::ValueType::DOUBLE };
+                    break;
+                }
+
+                case 2: {
+                    std::string content = this->string_content(false);
+                    text += "\"" + content + "\"";
+                    out = json::ValuePair{ new std::string(content), json::ValueType::STRING };
+                    break;
+                }
+
+                case 3: {
+                    json::PtrJson inner = new json::JSON();
+                    this->object(*inner, text, depth);
+                    out = json::ValuePair{ inner, json::ValueType::JSON };
+                    break;
+                }
+
+                case 4: {
+                    json::PtrList list = new json::List();
+                    text += "[";
+
+                    for (size_t n = this->members(depth), i = 0; i < n; i++) {
+                        if (i > 0) {
+                            text += this->whitespace() + ",";
+                        }
+
+                        text += this->whitespace();
+                        json::Value* item = new json::Value();
+                        this->value(*item, text, depth + 1, true);
+                        list->push_back(item);
+                    }
+
+                    text += this->whitespace() + "]";
+                    out = json::ValuePair{ list, json::ValueType::LIST };
+                    break;
+                }
+            }
+        }
+
+    private:
+        std::mt19937 m_random;
+        bool m_adversarial;
+        bool m_unsupported = false;
+    };
+
+    struct Sample {
+        std::string text;
+        std::unique_ptr<json::JSON> expected;
+        std::string filepath;
+    };
+
+    struct Engine {
+        size_t failures = 0;
+        size_t bytes = 0;
+        std::chrono::duration<double> elapsed{ 0 };
+    };
+
+    class Driver {
+    public:
+        // runs check on one document, times it and counts an exception or false as a failure
+        template<typename Check>
+        void run(const std::string& engine, const Sample& sample, Check check) {
+            auto& stats = this->m_engines[engine];
+            bool passed = false;
+            auto start = std::chrono::steady_clock::now();
+
+            try {
+                passed = check();
+            }
+            catch (std::exception&) {
+                passed = false;
+            }
+
+            stats.elapsed += std::chrono::steady_clock::now() - start;
+            stats.bytes += sample.text.size();
+
+            if (!passed) {
+                this->fail(engine, sample.text);
+            }
+        }
+
+        void fail(const std::string& engine, const std::string& text) {
+            if (this->m_engines[engine].failures++ < 3) {
+                std::cout << "MISMATCH [" << engine << "]: " << text.substr(0, 400) << std::endl;
+            }
+        }
+
+        void add_time(const std::string& engine, size_t bytes, std::chrono::duration<double> elapsed) {
+            this->m_engines[engine].bytes += bytes;
+            this->m_engines[engine].elapsed += elapsed;
+        }
+
+        size_t report(std::ostream& os, const std::string& prefix) {
+            size_t failures = 0;
+
+            for (auto& it : this->m_engines) {
+                double seconds = it.second.elapsed.count();
+                double throughput = seconds > 0 ? it.second.bytes / seconds / (1024 * 1024) : 0;
+
+                os << prefix << it.first << "," << it.second.bytes << "," << seconds << "," << throughput
+                   << "," << it.second.failures << "\n";
+                failures += it.second.failures;
+            }
+
+            return failures;
+        }
+
+    private:
+        std::map<std::string, Engine> m_engines;
+    };
+
+    std::string serialize(json::JSON& json) {
+        std::stringstream ss;
+        ss << json;
+        return ss.str();
+    }
+
+    std::string serialize(json::Document& document) {
+        std::stringstream ss;
+        ss << document;
+        return ss.str();
+    }
+
+    struct Location {
+        std::string pointer;
+        bool is_list;
+        size_t size; // lists only
+    };
+
+    void collect(json::Value& value, const std::string& pointer, std::vector<Location>& values, std::vector<Location>& containers);
+
+    void collect(json::JSON& json, const std::string& pointer, std::vector<Location>& values, std::vector<Location>& containers) {
+        containers.push_back({ pointer, false, 0 });
+
+        for (auto& it : json) {
+            collect(*it.second, pointer + "/" + json::patch::escape_token(it.first), values, containers);
+        }
+    }
+
+    // JSON Pointers of every value and every container of a tree
+    void collect(json::Value& value, const std::string& pointer, std::vector<Location>& values, std::vector<Location>& containers) {
+        bool is_list = value.type() == json::ValueType::LIST;
+        values.push_back({ pointer, is_list, is_list ? value.value<json::List>().size() : 0 });
+
+        if (value.type() == json::ValueType::JSON) {
+            collect(value.value<json::JSON>(), pointer, values, containers);
+        }
+
+        if (is_list) {
+            auto& list = value.value<json::List>();
+            containers.push_back({ pointer, true, list.size() });
+
+            for (size_t i = 0; i < list.size(); i++) {
+                collect(*list[i], pointer + "/" + std::to_string(i), values, containers);
+            }
+        }
+    }
+
+    // makes an invalid document most of the time, sometimes a different valid one
+    std::string corrupt(const std::string& text, std::mt19937& random) {
+        static const std::string bytes = "{}[]:,\"\\ x0-.e\x01\xc0\xff";
+        std::string corrupted = text;
+        size_t at = std::uniform_int_distribution<size_t>(0, text.size() - 1)(random);
+
+        switch (std::uniform_int_distribution<int>(0, 2)(random)) {
+            case 0:  corrupted.resize(at); break;
+            case 1:  corrupted[at] = bytes[std::uniform_int_distribution<size_t>(0, bytes.size() - 1)(random)]; break;
+            default: corrupted.erase(at, 1); break;
+        }
+
+        return corrupted;
+    }
+
+    void check_samples(Driver& driver, std::vector<Sample>& samples, unsigned seed) {
+        using namespace json::patch;
+
+        std::mt19937 random(seed);
+
+        for (auto& sample : samples) {
+            // what a load path returned against what the sample must load to
+            auto loads = [&](bool loaded, json::JSON& parsed) {
+                return sample.expected == nullptr ? !loaded : loaded && json::equals(parsed, *sample.expected);
+            };
+
+            driver.run("validate", sample, [&]() {
+                return static_cast<bool>(json::validate(sample.text));
+            });
+
+            driver.run("supported", sample, [&]() {
+                return fuzz::is_supported(sample.text) == (sample.expected != nullptr);
+            });
+
+            driver.run("load_from_string", sample, [&]() {
+                json::JSON parsed;
+                return loads(parsed.load_from_string(sample.text), parsed);
+            });
+
+            driver.run("load_from_file", sample, [&]() {
+                json::JSON parsed;
+                return loads(parsed.load_from_file(sample.filepath), parsed);
+            });
+
+            driver.run("document", sample, [&]() {
+                json::Document document;
+                return document.load_from_string(sample.text) == (sample.expected != nullptr);
+            });
+
+            std::string corrupted = corrupt(sample.text, random);
+            Sample rejected{ corrupted, nullptr, "" };
+            driver.run("validate_vs_load", rejected, [&]() {
+                bool expected = json::validate(corrupted) && fuzz::is_supported(corrupted);
+                json::JSON parsed;
+                return parsed.load_from_string(corrupted) == expected;
+            });
+
+            if (sample.expected == nullptr) {
+                continue;
+            }
+
+            driver.run("round_trip", sample, [&]() {
+                json::JSON parsed;
+                json::JSON reparsed;
+                return (
+                    parsed.load_from_string(sample.text)
+                    && reparsed.load_from_string(serialize(parsed))
+                    && json::equals(reparsed, *sample.expected)
+                );
+            });
+
+            driver.run("document_edits", sample, [&]() {
+                json::Document document;
+                if (!document.load_from_string(sample.text) || serialize(document) != sample.text) {
+                    return false;
+                }
+
+                json::JSON patched;
+                patched.load_from_string(sample.text);
+
+                std::vector<Location> values;
+                std::vector<Location> containers;
+                collect(patched, "", values, containers);
+
+                // a few edits anywhere in the tree, later ones may fail on what earlier ones changed
+                std::vector<PatchOperation> operations;
+                for (int edit = 0; edit < 3; edit++) {
+                    auto pick = [&](size_t size) {
+                        return std::uniform_int_distribution<size_t>(0, size - 1)(random);
+                    };
+
+                    Location& container = containers[pick(containers.size())];
+                    std::string added = container.pointer + "/" + (
+                        container.is_list ? std::to_string(pick(container.size + 1)) : "added" + std::to_string(edit)
+                    );
+
+                    json::Value value = edit % 2
+                        ? json::Value(new int(7), json::ValueType::INTEGER)
+                        : json::Value(new double(0.1), json::ValueType::DOUBLE);
+
+                    if (values.empty()) {
+                        operations.push_back({ Operation::ADD, added, "", std::move(value) });
+                        continue;
+                    }
+
+                    Location& location = values[pick(values.size())];
+                    switch (std::uniform_int_distribution<int>(0, 3)(random)) {
+                        case 0:  operations.push_back({ Operation::REPLACE, location.pointer, "", std::move(value) }); break;
+                        case 1:  operations.push_back({ Operation::REMOVE, location.pointer }); break;
+                        default: {
+                            // a list moved into a list could not be parsed back
+                            if (location.is_list && container.is_list) {
+                                operations.push_back({ Operation::ADD, added, "", std::move(value) });
+                                break;
+                            }
+
+                            operations.push_back({ Operation::MOVE, added, location.pointer });
+                            break;
+                        }
+                    }
+                }
+
+                json::JSON reparsed;
+                return (
+                    document.apply(operations) == apply(patched, operations)
+                    && reparsed.load_from_string(serialize(document))
+                    && json::equals(reparsed, patched)
+                );
+            });
+        }
+
+        std::vector<std::string> filepaths;
+        for (auto& sample : samples) {
+            filepaths.push_back(sample.filepath);
+        }
+
+        for (bool io_uring : { true, false }) {
+            std::string engine = io_uring ? "load_from_files" : "load_from_files_blocking";
+            size_t bytes = 0;
+            auto start = std::chrono::steady_clock::now();
+            {
+                json::BatchLoader loader(filepaths, 0, io_uring);
+
+                for (size_t i = 0; i < samples.size(); i++) {
+                    bytes += samples[i].text.size();
+
+                    try {
+                        auto parsed = loader[i].get();
+                        bool loaded = parsed != nullptr;
+                        bool expected = samples[i].expected != nullptr;
+                        if (loaded != expected || (loaded && !json::equals(*parsed, *samples[i].expected))) {
+                            driver.fail(engine, samples[i].text);
+                        }
+                    }
+                    catch (std::exception&) {
+                        driver.fail(engine, samples[i].text);
+                    }
+                }
+            }
+            driver.add_time(engine, bytes, std::chrono::steady_clock::now() - start);
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    size_t documents = 2000;
+    unsigned seed = 1;
+    std::string record;
+
+    std::vector<std::string> positional;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+
+        if (arg == "--record" && i + 1 < argc) {
+            record = argv[++i];
+            continue;
+        }
+
+        positional.push_back(arg);
+    }
+
+    if (positional.size() > 0) {
+        documents = std::stoul(positional[0]);
+    }
+
+    if (positional.size() > 1) {
+        seed = static_cast<unsigned>(std::stoul(positional[1]));
+    }
+
+    auto directory = std::filesystem::temp_directory_path() / ("json_differential_" + std::to_string(seed));
+    std::filesystem::create_directories(directory);
+
+    std::stringstream report;
+    size_t failures = 0;
+
+    for (bool adversarial : { false, true }) {
+        Generator generator(seed, adversarial);
+        std::vector<Sample> samples;
+
+        for (size_t i = 0; i < documents; i++) {
+            Sample sample;
+            sample.expected = generator.document(sample.text);
+            sample.filepath = (directory / (std::to_string(adversarial) + "_" + std::to_string(i) + ".json")).string();
+
+            std::ofstream(sample.filepath, std::ios::binary) << sample.text;
+            samples.push_back(std::move(sample));
+        }
+
+        Driver driver;
+        check_samples(driver, samples, seed);
+        failures += driver.report(report, std::to_string(seed) + "," + (adversarial ? "adversarial," : "random,"));
+    }
+
+    std::filesystem::remove_all(directory);
+
+    std::cout << "seed,corpus,engine,bytes,seconds,MB/s,failures\n" << report.str();
+
+    if (!record.empty()) {
+        std::ofstream(record, std::ios::app) << report.str();
+    }
+
+    if (failures) {
+        std::cout << failures << " MISMATCHES" << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,106 @@
+// libFuzzer target for every entry point that takes untrusted text.
+//
+//   clang++ -std=c++17 -g -O1 -fsanitize=fuzzer,address,undefined fuzz/fuzz_parser.cpp json/json.cpp -o fuzz_parser
+//   ./fuzz_parser -max_len=4096 fuzz_corpus/ resources/
+//
+// Built with -DJSON_FUZZ_STANDALONE (any compiler, no libFuzzer) it runs the files given
+// on the command line once, which is enough to replay a crash.
+
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../json/json.h"
+#include "supported.h"
+
+namespace {
+    void expect(bool condition, const char* what) {
+        if (!condition) {
+            std::cerr << "FUZZ CHECK FAILED: " << what << std::endl;
+            std::abort();
+        }
+    }
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    std::string input(reinterpret_cast<const char*>(data), size);
+
+    auto result = json::validate(input);
+    expect(result.position <= size, "validate: position is inside the input");
+    expect(result || result.error != json::ValidationError::NONE, "validate: failure has an error code");
+
+    json::JSON parsed;
+    bool loaded = false;
+
+    // any exception is a bug, unsupported input must be rejected with false
+    try {
+        loaded = parsed.load_from_string(input);
+    }
+    catch (std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        expect(false, "load_from_string: doesn't throw");
+    }
+
+    bool supported = result && fuzz::is_supported(input);
+    expect(loaded == supported, "load_from_string: accepts exactly the valid input the tree can hold");
+
+    if (!loaded) {
+        return 0;
+    }
+
+    json::Document document;
+    expect(document.load_from_string(input), "document: loads what load_from_string loads");
+
+    std::stringstream unchanged;
+    unchanged << document;
+    expect(unchanged.str() == input, "document: unchanged document is written as loaded");
+
+    // every root member replaced, the first one removed and a new one added
+    std::vector<json::patch::PatchOperation> operations;
+    for (auto& it : document.json()) {
+        operations.push_back({
+            json::patch::Operation::REPLACE,
+            "/" + json::patch::escape_token(it.first),
+            "",
+            json::Value(new int(1), json::ValueType::INTEGER)
+        });
+    }
+
+    if (!operations.empty()) {
+        operations.push_back({ json::patch::Operation::REMOVE, operations.front().path });
+    }
+    operations.push_back({ json::patch::Operation::ADD, "/fuzz~1added", "", json::Value(new double(0.1), json::ValueType::DOUBLE) });
+
+    expect(document.apply(operations), "document: the patch applies");
+
+    std::stringstream patched;
+    patched << document;
+
+    json::JSON reparsed;
+    expect(
+        reparsed.load_from_string(patched.str()) && json::equals(reparsed, document.json()),
+        "document: patched output parses to the patched tree"
+    );
+
+    return 0;
+}
+
+#ifdef JSON_FUZZ_STANDALONE
+#include <fstream>
+
+int main(int argc, char** argv) {
+    for (int i = 1; i < argc; i++) {
+        std::ifstream file(argv[i], std::ios::binary);
+        std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+        std::cout << argv[i] << std::endl;
+        LLVMFuzzerTestOneInput(reinterpret_cast<const uint8_t*>(content.data()), content.size());
+    }
+
+    return 0;
+}
+#endif
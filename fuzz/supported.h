@@ -0,0 +1,95 @@
+#ifndef __JSON_FUZZ_SUPPORTED__
+#define __JSON_FUZZ_SUPPORTED__
+
+#include <algorithm>
+#include <charconv>
+#include <string_view>
+#include <vector>
+
+namespace fuzz {
+    // Out of the text json::validate accepts, what json::JSON::load_from_string must accept too:
+    // an object root without true, false or null, without a list directly inside a list and with
+    // every number converting by std::from_chars, to int if it has no fraction and no exponent,
+    // to double otherwise.
+    inline bool is_supported(std::string_view text) {
+        std::vector<char> containers;
+        size_t i = text.find_first_not_of(" \t\r\n");
+
+        if (i == std::string_view::npos || text[i] != '{') {
+            return false;
+        }
+
+        while (i < text.size()) {
+            char c = text[i];
+
+            switch (c) {
+                case '"': {
+                    for (i++; text[i] != '"'; i++) {
+                        if (text[i] == '\\') {
+                            i++;
+                        }
+                    }
+                    i++;
+                    break;
+                }
+
+                case '{':
+                case '[': {
+                    if (c == '[' && !containers.empty() && containers.back() == '[') {
+                        return false;
+                    }
+
+                    containers.push_back(c);
+                    i++;
+                    break;
+                }
+
+                case '}':
+                case ']': {
+                    containers.pop_back();
+                    i++;
+                    break;
+                }
+
+                case 't':
+                case 'f':
+                case 'n': {
+                    return false;
+                }
+
+                case '-':
+                case '0': case '1': case '2': case '3': case '4':
+                case '5': case '6': case '7': case '8': case '9': {
+                    size_t end = std::min(text.find_first_not_of("+-.0123456789eE", i), text.size());
+                    const char* first = text.data() + i;
+                    const char* last = text.data() + end;
+                    std::from_chars_result result;
+
+                    if (text.substr(i, end - i).find_first_of(".eE") != std::string_view::npos) {
+                        double value = 0;
+                        result = std::from_chars(first, last, value);
+                    }
+                    else {
+                        int value = 0;
+                        result = std::from_chars(first, last, value);
+                    }
+
+                    if (result.ec != std::errc() || result.ptr != last) {
+                        return false;
+                    }
+
+                    i = end;
+                    break;
+                }
+
+                default: {
+                    i++; // whitespace, commas and colons
+                }
+            }
+        }
+
+        return true;
+    }
+}
+
+#endif // !__JSON_FUZZ_SUPPORTED__
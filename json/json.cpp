@@ -3,11 +3,38 @@
 #include <sstream>
 #include <cctype>
 #include <algorithm>
+#include <cstring>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <bitset>
+#include <filesystem>
+#include <charconv>
+#include <set>
+#include <stdexcept>
+#include <atomic>
+#include <cerrno>
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+    #include <linux/io_uring.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <sys/syscall.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
 
 #include "json.h"
 
 #define DEBUG 0
 
+#if defined(__linux__) && __has_include(<linux/io_uring.h>) && defined(__NR_io_uring_setup)
+    #define IO_URING 1
+#else
+    #define IO_URING 0
+#endif
+
 #if DEBUG == 1
     #define TODO(msg) (throw new std::runtime_error(msg))
     #define NOT_IMPLEMENTED (TODO("NOT IMPLEMENTED YET"))
@@ -33,6 +60,35 @@ namespace {
     {
         return ltrim(rtrim(str, chars), chars);
     }
+
+    // thrown by the lexer for valid JSON the tree can't hold
+    struct UnsupportedValue : std::runtime_error {
+        using std::runtime_error::runtime_error;
+    };
+
+    bool read_file(const std::string& filepath, std::string& out)
+    {
+        // directories open fine and report a huge size
+        std::error_code error;
+        if (!std::filesystem::is_regular_file(filepath, error)) {
+            return false;
+        }
+
+        std::ifstream file(filepath, std::ios::binary | std::ios::ate);
+
+        if (!file.is_open()) {
+            return false;
+        }
+
+        auto size = file.tellg();
+        if (size < 0) {
+            return false;
+        }
+
+        out.resize(static_cast<size_t>(size));
+        file.seekg(0);
+        return static_cast<bool>(file.read(out.data(), out.size()));
+    }
 }
 
 namespace json {
@@ -63,7 +119,16 @@ namespace json {
     }
 
     Value& Value::operator=(const Value& other) {
+        if (this == &other) {
+            return *this;
+        }
+
         this->reset();
+
+        if (other.m_value == nullptr) {
+            return *this;
+        }
+
         this->m_type = other.m_type;
 
         switch (this->m_type) {
@@ -74,8 +139,11 @@ namespace json {
             }
 
             case ValueType::JSON: {
-                this->m_value = new JSON;
-                std::memcpy(this->m_value, other.m_value, sizeof(JSON));
+                PtrJson json = new JSON;
+                for (auto& it : *static_cast<PtrJson>(other.m_value)) {
+                    (*json)[it.first] = *it.second;
+                }
+                this->m_value = json;
                 break;
             }
             
@@ -86,8 +154,16 @@ namespace json {
             }
 
             case ValueType::STRING: {
-                this->m_value = new double;
-                std::memcpy(this->m_value, other.m_value, sizeof(double));
+                this->m_value = new std::string(*static_cast<std::string*>(other.m_value));
+                break;
+            }
+
+            case ValueType::LIST: {
+                PtrList list = new List();
+                for (auto i : *static_cast<PtrList>(other.m_value)) {
+                    list->push_back(new Value(*i));
+                }
+                this->m_value = list;
                 break;
             }
 
@@ -98,6 +174,18 @@ namespace json {
         return *this;
     }
 
+    Value& Value::operator=(Value&& other) noexcept {
+        if (this == &other) {
+            return *this;
+        }
+
+        this->set(other.m_value, other.m_type);
+
+        other.m_type = ValueType::NONE;
+        other.m_value = nullptr;
+        return *this;
+    }
+
     Value& Value::operator=(const Value* other) {
         if (other == nullptr) {
             this->reset();
@@ -183,7 +271,15 @@ namespace json {
         }
 
         case ValueType::DOUBLE: {
-            os << v.value<double>();
+            // the shortest text that reads back as the same double
+            char buffer[32];
+            auto result = std::to_chars(buffer, buffer + sizeof(buffer), v.value<double>());
+            std::string_view text(buffer, result.ptr - buffer);
+
+            os << text;
+            if (text.find_first_of(".en") == std::string_view::npos) {
+                os << ".0"; // stays a double when parsed back
+            }
             break;
         }
 
@@ -227,7 +323,7 @@ namespace json {
         os << "{";
         auto t = value.m_json.begin();
         while (t != value.m_json.end()) {
-            os << "\"" << t->first << "\": " << t->second;
+            os << "\"" << t->first << "\": " << *t->second;
             t++;
             if (t != value.m_json.end()) {
                 os << ",";
@@ -248,19 +344,10 @@ namespace json {
     }
 
     bool JSON::load_from_file(std::string filepath){
-        std::ifstream file;
-        file.open(filepath);
-
-        if (file.is_open()) {
-            std::stringstream ss;
-            while(!file.eof()){
-                std::string str;
-                std::getline(file, str);
-                ss << str;
-            }
-            auto tokens = parser::Tokenize(ss.str());
-            parser::Lexer(tokens, *this);
-            return true;
+        std::string content;
+
+        if (read_file(filepath, content)) {
+            return this->load_from_string(std::move(content));
         }
 
         std::cout << "FILE NOT FOUND! FILE PATH: " << filepath << "\r\n";
@@ -268,8 +355,28 @@ namespace json {
     }
 
     bool JSON::load_from_string(std::string json_str) {
-        auto tokens = parser::Tokenize(json_str);
-        parser::Lexer(tokens, *this);
+        if (!validate(json_str)) {
+            return false;
+        }
+
+        // the tree is always an object
+        if (json_str[json_str.find_first_not_of(" \t\r\n")] != '{') {
+            return false;
+        }
+
+        JSON parsed;
+        try {
+            auto tokens = parser::Tokenize(json_str);
+            parser::Lexer(tokens, parsed);
+        }
+        catch (UnsupportedValue&) {
+            return false;
+        }
+
+        for (auto& it : parsed.m_json) {
+            this->m_json[it.first] = std::move(it.second);
+        }
+
         return true;
     }
 
@@ -281,209 +388,1925 @@ namespace json {
         return *m_json[str];
     }
 
+    bool JSON::contains(const std::string& key) const {
+        return m_json.find(key) != m_json.end();
+    }
+
+    bool JSON::erase(const std::string& key) {
+        return m_json.erase(key) > 0;
+    }
+
     JSON::~JSON() {
         // TODO: remove all data from map
     }
 
-    namespace parser {
-        struct SpecialTokens {
-            TokenType operator[](char key) {
-                switch (key) {
-                    case '(':  return TokenType::L_PAREN;
-                    case ')':  return TokenType::R_PAREN;
-                    case '{':  return TokenType::LC_BRACKET;
-                    case '}':  return TokenType::RC_BRACKET;
-                    case '[':  return TokenType::L_BRACKET;
-                    case ']':  return TokenType::R_BRACKET;
-                    case ':':  return TokenType::COLON;
-                    case ',':  return TokenType::COMMA;
-                    case '.':  return TokenType::DOT;
-                    case '\"': return TokenType::DOUBLE_QUOTE;
-                    default:   return TokenType::NONE;
+    namespace {
+        struct LoadJob {
+            std::string content;
+            std::promise<std::unique_ptr<JSON>> promise;
+        };
+
+        constexpr size_t READER_THREADS = 4; // blocking readers used without io_uring
+        constexpr unsigned RING_ENTRIES = 32; // reads in flight with io_uring
+        constexpr size_t MAX_READ = 1 << 30; // a single read is limited to 32 bits
+
+#if IO_URING
+        // Just enough of io_uring for IORING_OP_READ, set up with raw syscalls to avoid a liburing dependency.
+        class Ring {
+        public:
+            explicit Ring(unsigned entries) {
+                io_uring_params params;
+                std::memset(&params, 0, sizeof(params));
+
+                // ENOSYS before Linux 5.1, EPERM where seccomp blocks it
+                int fd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+                if (fd < 0) {
+                    return;
                 }
-            }
 
-            bool is_special_char(char t) {
-                return (*this)[t] != TokenType::NONE;
+                this->m_fd = fd;
+                this->m_sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+                this->m_cq_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+                this->m_sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+
+                bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+                if (single_mmap) {
+                    this->m_sq_size = this->m_cq_size = std::max(this->m_sq_size, this->m_cq_size);
+                }
+
+                this->m_sq = this->map(this->m_sq_size, IORING_OFF_SQ_RING);
+                this->m_cq = single_mmap ? this->m_sq : this->map(this->m_cq_size, IORING_OFF_CQ_RING);
+                this->m_sqes = static_cast<io_uring_sqe*>(this->map(this->m_sqes_size, IORING_OFF_SQES));
+
+                if (this->m_sq == nullptr || this->m_cq == nullptr || this->m_sqes == nullptr) {
+                    this->close();
+                    return;
+                }
+
+                char* sq = static_cast<char*>(this->m_sq);
+                this->m_sq_head = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+                this->m_sq_tail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+                this->m_sq_mask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+                this->m_sq_array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+                this->m_sq_entries = params.sq_entries;
+
+                char* cq = static_cast<char*>(this->m_cq);
+                this->m_cq_head = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+                this->m_cq_tail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+                this->m_cq_mask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+                this->m_cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
             }
-        };
 
-        std::vector<Token> Tokenize(std::string str) {
-            auto is_skippable = [](std::string& token, std::vector<Token>& tokens, char t) -> bool {
-                return (
-                    isspace(t)
-                    && tokens.size() > 0
-                    && (
-                        tokens.back().type != TokenType::DOUBLE_QUOTE
-                        || tokens.back().type == TokenType::COLON
-                    )
-                    && !token.size()
-                );
-            };
-            
+            Ring(const Ring&) = delete;
+            Ring& operator=(const Ring&) = delete;
 
-            std::vector<Token> tokens;
-            std::string token;
+            ~Ring() {
+                this->close();
+            }
 
-            SpecialTokens special_tokens;
+            bool is_open() const {
+                return this->m_fd >= 0;
+            }
 
-            for (char t : str) {
-                if (is_skippable(token, tokens, t)) {
-                    continue;
+            unsigned entries() const {
+                return this->m_sq_entries;
+            }
+
+            // queues a read of size bytes at offset, false if the submission queue is full
+            bool read(int fd, char* buffer, size_t size, size_t offset, uint64_t user_data) {
+                unsigned tail = *this->m_sq_tail;
+                if (tail - __atomic_load_n(this->m_sq_head, __ATOMIC_ACQUIRE) >= this->m_sq_entries) {
+                    return false;
                 }
 
-                if (special_tokens.is_special_char(t)) {
-                    if (token.size() > 0) {
-                        tokens.push_back(Token(token, TokenType::WORD));
-                        tokens.push_back(Token({ t }, special_tokens[t]));
+                unsigned index = tail & this->m_sq_mask;
+                io_uring_sqe& sqe = this->m_sqes[index];
+                std::memset(&sqe, 0, sizeof(sqe));
+                sqe.opcode = IORING_OP_READ;
+                sqe.fd = fd;
+                sqe.addr = reinterpret_cast<uint64_t>(buffer);
+                sqe.len = static_cast<unsigned>(std::min(size, MAX_READ));
+                sqe.off = offset;
+                sqe.user_data = user_data;
+
+                this->m_sq_array[index] = index;
+                __atomic_store_n(this->m_sq_tail, tail + 1, __ATOMIC_RELEASE);
+                this->m_queued++;
+                return true;
+            }
+
+            // submits the queued reads and waits until at least one of them completed
+            bool wait() {
+                while (true) {
+                    long submitted = syscall(__NR_io_uring_enter, this->m_fd, this->m_queued, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+                    if (submitted >= 0) {
+                        this->m_queued -= static_cast<unsigned>(submitted);
+                        return true;
                     }
-                    else {
-                        tokens.push_back(Token({ t }, special_tokens[t]));
+
+                    if (errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+                        return false;
                     }
+                }
+            }
 
-                    token = "";
-                    continue;
+            // takes the next completion, result is what read(2) would return or -errno
+            bool complete(uint64_t& user_data, int& result) {
+                unsigned head = *this->m_cq_head;
+                if (head == __atomic_load_n(this->m_cq_tail, __ATOMIC_ACQUIRE)) {
+                    return false;
                 }
 
-                token += t;
+                io_uring_cqe& cqe = this->m_cqes[head & this->m_cq_mask];
+                user_data = cqe.user_data;
+                result = cqe.res;
+                __atomic_store_n(this->m_cq_head, head + 1, __ATOMIC_RELEASE);
+                return true;
             }
 
-            return tokens;
+        private:
+            void* map(size_t size, off_t offset) {
+                void* ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, this->m_fd, offset);
+                return ptr == MAP_FAILED ? nullptr : ptr;
+            }
+
+            void close() {
+                if (this->m_sqes != nullptr) {
+                    munmap(this->m_sqes, this->m_sqes_size);
+                }
+                if (this->m_cq != nullptr && this->m_cq != this->m_sq) {
+                    munmap(this->m_cq, this->m_cq_size);
+                }
+                if (this->m_sq != nullptr) {
+                    munmap(this->m_sq, this->m_sq_size);
+                }
+                if (this->m_fd >= 0) {
+                    ::close(this->m_fd);
+                }
+
+                this->m_sq = this->m_cq = nullptr;
+                this->m_sqes = nullptr;
+                this->m_fd = -1;
+            }
+
+        private:
+            int m_fd = -1;
+            unsigned m_queued = 0; // queued but not submitted yet
+
+            void* m_sq = nullptr;
+            void* m_cq = nullptr;
+            io_uring_sqe* m_sqes = nullptr;
+            size_t m_sq_size = 0;
+            size_t m_cq_size = 0;
+            size_t m_sqes_size = 0;
+
+            unsigned* m_sq_head = nullptr;
+            unsigned* m_sq_tail = nullptr;
+            unsigned* m_sq_array = nullptr;
+            unsigned m_sq_mask = 0;
+            unsigned m_sq_entries = 0;
+
+            unsigned* m_cq_head = nullptr;
+            unsigned* m_cq_tail = nullptr;
+            unsigned m_cq_mask = 0;
+            io_uring_cqe* m_cqes = nullptr;
+        };
+#endif
+    }
+
+    struct BatchLoader::Queue {
+        std::mutex mutex;
+        std::condition_variable ready; // a job was queued or the last reader finished
+        std::condition_variable space; // a job was taken
+        std::deque<LoadJob> jobs;
+        size_t capacity = 1;
+        size_t readers = 0; // readers still running
+        bool cancelled = false;
+
+        std::vector<std::string> filepaths;
+        std::vector<std::promise<std::unique_ptr<JSON>>> promises; // each one is used by a single reader
+        std::atomic<size_t> next{ 0 }; // next file for the blocking readers
+
+        bool is_cancelled() {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            return this->cancelled;
         }
 
-        size_t Lexer(std::vector<Token>& tokens, JSON& out_json) {
-            VectorView<Token> view = tokens;
-            return Lexer(view, out_json);
+        // waits for room, the job is dropped if the loader is destroyed meanwhile
+        void push(LoadJob&& job) {
+            std::unique_lock<std::mutex> lock(this->mutex);
+            this->space.wait(lock, [&]() { return this->cancelled || this->jobs.size() < this->capacity; });
+
+            if (this->cancelled) {
+                return;
+            }
+
+            try {
+                this->jobs.push_back(std::move(job));
+            }
+            catch (...) {
+                job.promise.set_exception(std::current_exception());
+                return;
+            }
+
+            lock.unlock();
+            this->ready.notify_one();
         }
 
-        size_t Lexer(VectorView<Token>& tokens, JSON& out_json) {
-            size_t i = 0;
+        // waits for a job, false once every reader finished and the queue is empty
+        bool pop(LoadJob& job) {
+            std::unique_lock<std::mutex> lock(this->mutex);
+            this->ready.wait(lock, [&]() { return this->cancelled || this->readers == 0 || !this->jobs.empty(); });
 
-            std::cout << "LEXER: " << out_json << std::endl;
+            if (this->cancelled || this->jobs.empty()) {
+                return false;
+            }
 
-            auto check_token = [&](Token& token)-> bool {
-                return 
-                    token.type == TokenType::DOUBLE_QUOTE // check if this is not string structure
-                    && (
-                        i == 0 // if starting point, this is true
-                        || (i > 0) // if this is value
-                        && tokens[i - 1].type != TokenType::COLON // check not : because this is must be a value
-                    );
-            };
+            job = std::move(this->jobs.front());
+            this->jobs.pop_front();
 
-            auto parseInnerJson = [&](size_t inner_index) -> PtrJson {
-                PtrJson parsed_json = new JSON();
-                VectorView<Token> view(tokens, inner_index);
+            lock.unlock();
+            this->space.notify_one();
+            return true;
+        }
 
-                // recurcive (((
-                i += Lexer(view, *parsed_json);
-                return parsed_json;
-            };
+        void finish_reader() {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            if (--this->readers == 0) {
+                this->ready.notify_all();
+            }
+        }
 
-            auto parseStr = [&]()-> std::string* {
-                std::string temp_str;
-                ++i; // consume first quote
+        void read_blocking() {
+            for (size_t i = this->next++; i < this->filepaths.size() && !this->is_cancelled(); i = this->next++) {
+                LoadJob job;
 
-                for (Token token = tokens[i]; token.type != TokenType::DOUBLE_QUOTE; token = tokens[++i]) {
-                    temp_str += token.value;
+                try {
+                    if (!read_file(this->filepaths[i], job.content)) {
+                        this->promises[i].set_value(nullptr);
+                        continue;
+                    }
+                }
+                catch (...) {
+                    this->promises[i].set_exception(std::current_exception());
+                    continue;
                 }
 
-                std::string* str = new std::string(temp_str);
-                ++i; // consume last quote
-                return str;
+                job.promise = std::move(this->promises[i]);
+                this->push(std::move(job));
+            }
+        }
+
+#if IO_URING
+        // keeps up to ring.entries() files in flight, a file is queued for the parsers as soon as its last read completes
+        void read_ring(Ring& ring) {
+            struct Read {
+                int fd = -1;
+                size_t file = 0;
+                size_t done = 0;
+                std::string content;
             };
 
-            auto parseValue = [&](Value& v) -> Value* {
-                std::string possible_value;
+            std::vector<Read> reads(ring.entries());
+            std::vector<size_t> free_reads;
+            for (size_t slot = reads.size(); slot > 0; slot--) {
+                free_reads.push_back(slot - 1);
+            }
 
-                for (
-                    Token token = tokens[i];
-                    (
-                        token.type != TokenType::COMMA
-                        && token.type != TokenType::RC_BRACKET
-                        && token.type != TokenType::R_BRACKET
-                    );
-                    token = tokens[++i]
-                ) {
-                    possible_value += token.value;
-                }
+            auto submit = [&](size_t slot) {
+                Read& read = reads[slot];
+                ring.read(read.fd, &read.content[read.done], read.content.size() - read.done, read.done, slot);
+            };
 
-                if (possible_value.find('.') != std::string::npos) {
-                    double* value = new double();
-                    *value = std::stod(possible_value);
-                    v = ValuePair{ value, ValueType::DOUBLE };
-                }
-                else {
-                    int* value = new int();
-                    *value = std::stoi(possible_value);
-                    v = ValuePair{ value, ValueType::INTEGER };
+            auto finish = [&](size_t slot, bool read_ok) {
+                Read& read = reads[slot];
+                ::close(read.fd);
+                read.fd = -1;
+                free_reads.push_back(slot);
+
+                if (!read_ok) {
+                    this->promises[read.file].set_value(nullptr);
+                    return;
                 }
 
-                return &v;
+                LoadJob job;
+                job.content = std::move(read.content);
+                job.promise = std::move(this->promises[read.file]);
+                this->push(std::move(job));
             };
 
-            while (i < tokens.size()) {
-                Token token = tokens[i];
+            // what read_file would do, for a read the ring can't do
+            auto pread_rest = [&](Read& read) {
+                while (read.done < read.content.size()) {
+                    ssize_t result = pread(read.fd, &read.content[read.done], read.content.size() - read.done, read.done);
+                    if (result < 0 && errno == EINTR) {
+                        continue;
+                    }
+                    if (result <= 0) {
+                        return false;
+                    }
+                    read.done += static_cast<size_t>(result);
+                }
+                return true;
+            };
 
-                if (token.type == TokenType::LC_BRACKET) {
-                    i++;
-                    continue;
+            size_t in_flight = 0;
+
+            while (true) {
+                while (!free_reads.empty() && this->next < this->filepaths.size() && !this->is_cancelled()) {
+                    size_t file = this->next++;
+                    size_t slot = free_reads.back();
+                    Read& read = reads[slot];
+
+                    try {
+                        struct stat status;
+                        int fd = ::open(this->filepaths[file].c_str(), O_RDONLY | O_CLOEXEC);
+
+                        if (fd < 0 || fstat(fd, &status) != 0 || !S_ISREG(status.st_mode)) {
+                            if (fd >= 0) {
+                                ::close(fd);
+                            }
+                            this->promises[file].set_value(nullptr);
+                            continue;
+                        }
+
+                        read.fd = fd;
+                        read.file = file;
+                        read.done = 0;
+                        read.content.assign(static_cast<size_t>(status.st_size), '\0');
+                    }
+                    catch (...) {
+                        ::close(read.fd);
+                        read.fd = -1;
+                        this->promises[file].set_exception(std::current_exception());
+                        continue;
+                    }
+
+                    free_reads.pop_back();
+
+                    if (read.content.empty()) {
+                        finish(slot, true);
+                        continue;
+                    }
+
+                    submit(slot);
+                    in_flight++;
                 }
 
-                if (token.type == TokenType::RC_BRACKET) {
-                    i++;
+                if (in_flight == 0) {
                     break;
                 }
 
-                if (!check_token(token))
-                {
-                    i++;
-                    continue;
+                if (!ring.wait()) {
+                    // the reads in flight can't be waited for, the kernel may still write to their buffers
+                    for (auto& read : reads) {
+                        if (read.fd >= 0) {
+                            this->promises[read.file].set_value(nullptr);
+                        }
+                    }
+                    new std::vector<Read>(std::move(reads)); // leaked on purpose, a move keeps the elements in place
+                    break;
                 }
-                
-                i++;
-                token = tokens[i];
-                std::string key = token.value;
 
-                i += 3; // this is +3 because token<key>, token<">, token<:> and than continues
-                token = tokens[i];
+                uint64_t slot = 0;
+                int result = 0;
 
-                switch (token.type) {
-                    case TokenType::LC_BRACKET: { // parse inner json
-                        out_json[key] = ValuePair{ parseInnerJson(i), ValueType::JSON };
+                while (ring.complete(slot, result)) {
+                    Read& read = reads[slot];
+
+                    if ((result == -EINTR || result == -EAGAIN) && !this->is_cancelled()) {
+                        submit(slot);
                         continue;
                     }
 
-                    case TokenType::DOUBLE_QUOTE: {
-                        out_json[key] = ValuePair{ parseStr(), ValueType::STRING };
-                        token = tokens[i];
+                    in_flight--;
+
+                    if (result < 0) {
+                        // IORING_OP_READ needs Linux 5.6, older kernels answer -EINVAL
+                        finish(slot, result != -EINTR && result != -EAGAIN && pread_rest(read));
                         continue;
                     }
 
-                    case TokenType::L_BRACKET: {
-                        PtrList list = new List();
-                        i++;
-                        token = tokens[i];
-                        std::string temp_str;
+                    read.done += static_cast<size_t>(result);
 
-                        while (token.type != TokenType::R_BRACKET)
-                        {
-                            switch (token.type)
-                            {
-                                case TokenType::DOUBLE_QUOTE: {
-                                    list->push_back(
-                                        new Value(
-                                            parseStr(),
-                                            ValueType::STRING
-                                        )
-                                    );
-                                    token = tokens[i];
-                                    continue;
-                                }
+                    // a short read, the rest is read by the next one
+                    if (result > 0 && read.done < read.content.size() && !this->is_cancelled()) {
+                        submit(slot);
+                        in_flight++;
+                        continue;
+                    }
 
-                                case TokenType::LC_BRACKET: { // parse inner json in list
-                                    auto parsed_json = parseInnerJson(i);
-                                    std::cout << *parsed_json << std::endl;
+                    read.content.resize(read.done); // the file shrank
+                    finish(slot, true);
+                }
+            }
+        }
+#endif
+    };
+
+    BatchLoader::BatchLoader(const std::vector<std::string>& filepaths, size_t workers, bool io_uring) :
+        m_queue(std::make_unique<Queue>())
+    {
+        if (workers == 0) {
+            workers = std::max(1u, std::thread::hardware_concurrency());
+        }
+
+        Queue* queue = this->m_queue.get();
+        queue->capacity = 2 * workers; // enough read ahead to keep every worker busy, memory stays bounded
+        queue->filepaths = filepaths;
+        queue->promises.resize(filepaths.size());
+
+        this->m_futures.reserve(filepaths.size());
+        for (auto& promise : queue->promises) {
+            this->m_futures.push_back(promise.get_future());
+        }
+
+        try {
+            bool reading = false;
+
+#if IO_URING
+            std::unique_ptr<Ring> ring = io_uring ? std::make_unique<Ring>(RING_ENTRIES) : nullptr;
+
+            // one thread keeps many reads in flight
+            if (ring != nullptr && ring->is_open()) {
+                queue->readers = 1;
+                reading = true;
+                this->m_threads.emplace_back([queue, ring = std::move(ring)]() {
+                    queue->read_ring(*ring);
+                    queue->finish_reader();
+                });
+            }
+#else
+            (void)io_uring;
+#endif
+
+            if (!reading) {
+                size_t readers = std::min(READER_THREADS, std::max<size_t>(1, filepaths.size()));
+                queue->readers = readers;
+
+                for (size_t r = 0; r < readers; r++) {
+                    this->m_threads.emplace_back([queue]() {
+                        queue->read_blocking();
+                        queue->finish_reader();
+                    });
+                }
+            }
+
+            for (size_t w = 0; w < workers; w++) {
+                this->m_threads.emplace_back([queue]() {
+                    LoadJob job;
+
+                    while (queue->pop(job)) {
+                        try {
+                            auto parsed_json = std::make_unique<JSON>();
+
+                            if (!parsed_json->load_from_string(std::move(job.content))) {
+                                parsed_json = nullptr;
+                            }
+
+                            job.promise.set_value(std::move(parsed_json));
+                        }
+                        catch (...) {
+                            job.promise.set_exception(std::current_exception());
+                        }
+                    }
+                });
+            }
+        }
+        catch (...) {
+            // a thread failed to start, the ones already running must not outlive the loader
+            this->stop();
+            throw;
+        }
+    }
+
+    BatchLoader::~BatchLoader() {
+        this->stop();
+    }
+
+    void BatchLoader::stop() {
+        {
+            std::lock_guard<std::mutex> lock(this->m_queue->mutex);
+            this->m_queue->cancelled = true;
+        }
+        this->m_queue->ready.notify_all();
+        this->m_queue->space.notify_all();
+
+        for (auto& thread : this->m_threads) {
+            thread.join();
+        }
+    }
+
+    BatchLoader load_from_files(const std::vector<std::string>& filepaths, size_t workers) {
+        return BatchLoader(filepaths, workers);
+    }
+
+    namespace {
+        bool is_hex(char c) {
+            return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+        }
+
+        bool is_digit(char c) {
+            return c >= '0' && c <= '9';
+        }
+
+        // returns the length of the UTF-8 sequence at str[i] or 0 if it is not valid
+        size_t utf8_sequence(std::string_view str, size_t i) {
+            auto byte = [&](size_t k) -> unsigned char {
+                return static_cast<unsigned char>(str[i + k]);
+            };
+            auto is_continuation = [&](size_t k) -> bool {
+                return i + k < str.size() && (byte(k) & 0xC0) == 0x80;
+            };
+
+            unsigned char lead = byte(0);
+
+            if (lead >= 0xC2 && lead <= 0xDF) {
+                return is_continuation(1) ? 2 : 0;
+            }
+
+            if (lead >= 0xE0 && lead <= 0xEF) {
+                if (!is_continuation(1) || !is_continuation(2)) {
+                    return 0;
+                }
+                // overlong forms and UTF-16 surrogates
+                if ((lead == 0xE0 && byte(1) < 0xA0) || (lead == 0xED && byte(1) > 0x9F)) {
+                    return 0;
+                }
+                return 3;
+            }
+
+            if (lead >= 0xF0 && lead <= 0xF4) {
+                if (!is_continuation(1) || !is_continuation(2) || !is_continuation(3)) {
+                    return 0;
+                }
+                // overlong forms and code points above U+10FFFF
+                if ((lead == 0xF0 && byte(1) < 0x90) || (lead == 0xF4 && byte(1) > 0x8F)) {
+                    return 0;
+                }
+                return 4;
+            }
+
+            return 0;
+        }
+    }
+
+    bool equals(Value& left, Value& right) {
+        if (left.type() != right.type()) {
+            return false;
+        }
+
+        switch (left.type()) {
+            case ValueType::NONE:    return true;
+            case ValueType::INTEGER: return left.value<int>() == right.value<int>();
+            case ValueType::DOUBLE:  return left.value<double>() == right.value<double>();
+            case ValueType::STRING:  return left.value<std::string>() == right.value<std::string>();
+
+            case ValueType::LIST: {
+                auto& l = left.value<List>();
+                auto& r = right.value<List>();
+
+                if (l.size() != r.size()) {
+                    return false;
+                }
+
+                for (size_t i = 0; i < l.size(); i++) {
+                    if (!equals(*l[i], *r[i])) {
+                        return false;
+                    }
+                }
+
+                return true;
+            }
+
+            case ValueType::JSON: {
+                return equals(left.value<JSON>(), right.value<JSON>());
+            }
+        }
+
+        return false;
+    }
+
+    bool equals(JSON& left, JSON& right) {
+        if (std::distance(left.begin(), left.end()) != std::distance(right.begin(), right.end())) {
+            return false;
+        }
+
+        for (auto& it : left) {
+            if (!right.contains(it.first) || !equals(*it.second, right[it.first])) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    ValidationResult validate(std::string_view str) {
+        enum class State {
+            VALUE,
+            FIRST_VALUE, // right after [
+            FIRST_KEY, // right after {
+            KEY,
+            AFTER_VALUE
+        };
+
+        ValidationResult result;
+        std::bitset<VALIDATION_MAX_DEPTH> is_object; // kind of every open container
+        size_t depth = 0;
+        size_t i = 0;
+        State state = State::VALUE;
+
+        auto fail = [&](ValidationError error, size_t position) -> ValidationResult& {
+            result.error = error;
+            result.position = position;
+            return result;
+        };
+
+        auto skip_whitespace = [&]() {
+            while (i < str.size() && (str[i] == ' ' || str[i] == '\t' || str[i] == '\n' || str[i] == '\r')) {
+                i++;
+            }
+        };
+
+        // i points at the opening quote, on success points past the closing one
+        auto scan_string = [&]() -> bool {
+            i++;
+
+            while (i < str.size()) {
+                unsigned char c = static_cast<unsigned char>(str[i]);
+
+                if (c == '"') {
+                    i++;
+                    return true;
+                }
+
+                if (c < 0x20) {
+                    fail(ValidationError::INVALID_STRING, i);
+                    return false;
+                }
+
+                if (c == '\\') {
+                    if (i + 1 >= str.size()) {
+                        break;
+                    }
+
+                    switch (str[i + 1]) {
+                        case '"': case '\\': case '/': case 'b': case 'f': case 'n': case 'r': case 't': {
+                            i += 2;
+                            continue;
+                        }
+
+                        case 'u': {
+                            for (size_t k = 2; k < 6; k++) {
+                                if (i + k >= str.size()) {
+                                    fail(ValidationError::UNEXPECTED_END, str.size());
+                                    return false;
+                                }
+                                if (!is_hex(str[i + k])) {
+                                    fail(ValidationError::INVALID_ESCAPE, i);
+                                    return false;
+                                }
+                            }
+                            i += 6;
+                            continue;
+                        }
+
+                        default: {
+                            fail(ValidationError::INVALID_ESCAPE, i);
+                            return false;
+                        }
+                    }
+                }
+
+                if (c >= 0x80) {
+                    size_t length = utf8_sequence(str, i);
+                    if (length == 0) {
+                        fail(ValidationError::INVALID_UTF8, i);
+                        return false;
+                    }
+                    i += length;
+                    continue;
+                }
+
+                i++;
+            }
+
+            fail(ValidationError::UNEXPECTED_END, str.size());
+            return false;
+        };
+
+        auto scan_number = [&]() -> bool {
+            if (str[i] == '-') {
+                i++;
+            }
+
+            if (i < str.size() && str[i] == '0') {
+                i++;
+            }
+            else if (i < str.size() && is_digit(str[i])) {
+                while (i < str.size() && is_digit(str[i])) i++;
+            }
+            else {
+                fail(ValidationError::INVALID_NUMBER, i);
+                return false;
+            }
+
+            if (i < str.size() && str[i] == '.') {
+                i++;
+                if (i >= str.size() || !is_digit(str[i])) {
+                    fail(ValidationError::INVALID_NUMBER, i);
+                    return false;
+                }
+                while (i < str.size() && is_digit(str[i])) i++;
+            }
+
+            if (i < str.size() && (str[i] == 'e' || str[i] == 'E')) {
+                i++;
+                if (i < str.size() && (str[i] == '+' || str[i] == '-')) {
+                    i++;
+                }
+                if (i >= str.size() || !is_digit(str[i])) {
+                    fail(ValidationError::INVALID_NUMBER, i);
+                    return false;
+                }
+                while (i < str.size() && is_digit(str[i])) i++;
+            }
+
+            return true;
+        };
+
+        auto scan_literal = [&](std::string_view literal) -> bool {
+            if (str.substr(i, literal.size()) != literal) {
+                fail(ValidationError::UNEXPECTED_CHARACTER, i);
+                return false;
+            }
+
+            i += literal.size();
+            return true;
+        };
+
+        auto open = [&](bool object) -> bool {
+            if (depth == VALIDATION_MAX_DEPTH) {
+                fail(ValidationError::DEPTH_EXCEEDED, i);
+                return false;
+            }
+
+            is_object[depth++] = object;
+            i++;
+            return true;
+        };
+
+        while (true) {
+            skip_whitespace();
+
+            if (i >= str.size()) {
+                if (state == State::AFTER_VALUE && depth == 0) {
+                    break;
+                }
+                return fail(ValidationError::UNEXPECTED_END, str.size());
+            }
+
+            char c = str[i];
+
+            switch (state) {
+                case State::FIRST_VALUE: {
+                    if (c == ']') {
+                        depth--;
+                        i++;
+                        state = State::AFTER_VALUE;
+                        continue;
+                    }
+                    state = State::VALUE;
+                    continue;
+                }
+
+                case State::FIRST_KEY: {
+                    if (c == '}') {
+                        depth--;
+                        i++;
+                        state = State::AFTER_VALUE;
+                        continue;
+                    }
+                    state = State::KEY;
+                    continue;
+                }
+
+                case State::KEY: {
+                    if (c != '"') {
+                        return fail(ValidationError::UNEXPECTED_CHARACTER, i);
+                    }
+                    if (!scan_string()) {
+                        return result;
+                    }
+
+                    skip_whitespace();
+                    if (i >= str.size()) {
+                        return fail(ValidationError::UNEXPECTED_END, str.size());
+                    }
+                    if (str[i] != ':') {
+                        return fail(ValidationError::UNEXPECTED_CHARACTER, i);
+                    }
+
+                    i++;
+                    state = State::VALUE;
+                    continue;
+                }
+
+                case State::VALUE: {
+                    bool scanned = true;
+
+                    switch (c) {
+                        case '{': {
+                            if (!open(true)) {
+                                return result;
+                            }
+                            state = State::FIRST_KEY;
+                            continue;
+                        }
+
+                        case '[': {
+                            if (!open(false)) {
+                                return result;
+                            }
+                            state = State::FIRST_VALUE;
+                            continue;
+                        }
+
+                        case '"': scanned = scan_string(); break;
+                        case 't': scanned = scan_literal("true"); break;
+                        case 'f': scanned = scan_literal("false"); break;
+                        case 'n': scanned = scan_literal("null"); break;
+
+                        default: {
+                            if (c != '-' && !is_digit(c)) {
+                                return fail(ValidationError::UNEXPECTED_CHARACTER, i);
+                            }
+                            scanned = scan_number();
+                            break;
+                        }
+                    }
+
+                    if (!scanned) {
+                        return result;
+                    }
+
+                    state = State::AFTER_VALUE;
+                    continue;
+                }
+
+                case State::AFTER_VALUE: {
+                    if (depth == 0) {
+                        return fail(ValidationError::TRAILING_CHARACTERS, i);
+                    }
+
+                    bool in_object = is_object[depth - 1];
+
+                    if (c == ',') {
+                        i++;
+                        state = in_object ? State::KEY : State::VALUE;
+                        continue;
+                    }
+
+                    if ((in_object && c == '}') || (!in_object && c == ']')) {
+                        depth--;
+                        i++;
+                        continue;
+                    }
+
+                    return fail(ValidationError::UNEXPECTED_CHARACTER, i);
+                }
+            }
+        }
+
+        return result;
+    }
+
+    namespace patch {
+        std::string escape_token(const std::string& token) {
+            std::string escaped;
+
+            for (char c : token) {
+                switch (c) {
+                    case '~': escaped += "~0"; break;
+                    case '/': escaped += "~1"; break;
+                    default:  escaped += c;
+                }
+            }
+
+            return escaped;
+        }
+
+        namespace {
+            // the object or the list which holds the value addressed by the last pointer token
+            struct Parent {
+                PtrJson json = nullptr;
+                PtrList list = nullptr;
+            };
+
+            // what a single step did to the document, enough to revert it
+            enum class Change {
+                INSERTED,
+                TAKEN,
+                REPLACED
+            };
+
+            struct Undo {
+                Undo(Change change, std::vector<std::string> tokens, Value previous = Value(), bool moved = false) :
+                    change(change), tokens(std::move(tokens)), previous(std::move(previous)), moved(moved)
+                {
+                }
+
+                Change change;
+                std::vector<std::string> tokens; // list indexes are stored resolved, never "-"
+                Value previous; // TAKEN and REPLACED only
+                bool moved = false; // TAKEN by a move, the value is carried by the following step
+            };
+
+            using UndoLog = std::vector<Undo>;
+
+            // values and containers changed by a patch, Document serializes only those
+            struct Tracker {
+                std::set<const Value*> rewritten;
+                std::set<const void*> touched; // JSON or List, every container on the way to a change
+            };
+
+            // RFC 6901: "" is the whole document, every other pointer starts with / and
+            // escapes ~ and / as ~0 and ~1
+            bool split_pointer(const std::string& pointer, std::vector<std::string>& tokens) {
+                tokens.clear();
+
+                if (pointer.empty()) {
+                    return true;
+                }
+
+                if (pointer[0] != '/') {
+                    return false;
+                }
+
+                size_t start = 1;
+                while (start <= pointer.size()) {
+                    size_t end = pointer.find('/', start);
+                    if (end == std::string::npos) {
+                        end = pointer.size();
+                    }
+
+                    std::string token;
+                    for (size_t pos = start; pos < end; pos++) {
+                        if (pointer[pos] != '~') {
+                            token += pointer[pos];
+                            continue;
+                        }
+
+                        if (pos + 1 >= end || (pointer[pos + 1] != '0' && pointer[pos + 1] != '1')) {
+                            return false;
+                        }
+
+                        token += pointer[++pos] == '1' ? '/' : '~';
+                    }
+
+                    tokens.push_back(token);
+                    start = end + 1;
+                }
+
+                return true;
+            }
+
+            // returns npos for "-" (end of list) and for anything that is not an index
+            size_t to_index(const std::string& token) {
+                if (token.empty() || (token.size() > 1 && token[0] == '0')) {
+                    return std::string::npos;
+                }
+
+                size_t index = 0;
+                auto result = std::from_chars(token.data(), token.data() + token.size(), index);
+                if (result.ec != std::errc() || result.ptr != token.data() + token.size()) {
+                    return std::string::npos;
+                }
+
+                return index;
+            }
+
+            Value* child(Parent& parent, const std::string& token) {
+                if (parent.json != nullptr) {
+                    return parent.json->contains(token) ? &(*parent.json)[token] : nullptr;
+                }
+
+                size_t index = to_index(token);
+                if (index >= parent.list->size()) {
+                    return nullptr;
+                }
+
+                return (*parent.list)[index];
+            }
+
+            bool as_parent(Value* value, Parent& parent) {
+                parent = Parent();
+
+                if (value == nullptr) {
+                    return false;
+                }
+
+                switch (value->type()) {
+                    case ValueType::JSON: {
+                        parent.json = &value->value<JSON>();
+                        return true;
+                    }
+
+                    case ValueType::LIST: {
+                        parent.list = &value->value<List>();
+                        return true;
+                    }
+
+                    default:
+                        return false;
+                }
+            }
+
+            // walks every token except the last one, the root itself is not addressable
+            bool resolve(JSON& target, const std::vector<std::string>& tokens, Parent& parent) {
+                if (tokens.empty()) {
+                    return false;
+                }
+
+                parent = Parent();
+                parent.json = &target;
+
+                for (size_t i = 0; i + 1 < tokens.size(); i++) {
+                    if (!as_parent(child(parent, tokens[i]), parent)) {
+                        return false;
+                    }
+                }
+
+                return true;
+            }
+
+            Value* get(JSON& target, const std::vector<std::string>& tokens) {
+                Parent parent;
+
+                if (!resolve(target, tokens, parent)) {
+                    return nullptr;
+                }
+
+                return child(parent, tokens.back());
+            }
+
+            // marks the containers on the way to the last token, the root included
+            void touch(JSON& target, const std::vector<std::string>& tokens, Tracker* tracker) {
+                if (tracker == nullptr) {
+                    return;
+                }
+
+                Parent parent;
+                parent.json = &target;
+                tracker->touched.insert(&target);
+
+                for (size_t i = 0; i + 1 < tokens.size(); i++) {
+                    if (!as_parent(child(parent, tokens[i]), parent)) {
+                        return;
+                    }
+
+                    tracker->touched.insert(parent.json != nullptr ? static_cast<const void*>(parent.json) : parent.list);
+                }
+            }
+
+            // marks the value at tokens as new, it has no source text
+            void rewrite(JSON& target, const std::vector<std::string>& tokens, Tracker* tracker) {
+                if (tracker == nullptr) {
+                    return;
+                }
+
+                touch(target, tokens, tracker);
+                tracker->rewritten.insert(get(target, tokens));
+            }
+
+            // puts value at the key or index, index must be in [0, size]
+            void put(Parent& parent, const std::string& token, Value&& value) {
+                if (parent.json != nullptr) {
+                    (*parent.json)[token] = std::move(value);
+                    return;
+                }
+
+                parent.list->insert(parent.list->begin() + to_index(token), new Value(std::move(value)));
+            }
+
+            // removes the existing key or index and returns what was there
+            Value remove(Parent& parent, const std::string& token) {
+                Value removed;
+
+                if (parent.json != nullptr) {
+                    removed = std::move((*parent.json)[token]);
+                    parent.json->erase(token);
+                    return removed;
+                }
+
+                size_t index = to_index(token);
+                Value* item = (*parent.list)[index];
+                removed = std::move(*item);
+                delete item;
+                parent.list->erase(parent.list->begin() + index);
+                return removed;
+            }
+
+            bool insert(JSON& target, std::vector<std::string> tokens, Value&& value, UndoLog& log, Tracker* tracker) {
+                Parent parent;
+
+                if (!resolve(target, tokens, parent)) {
+                    return false;
+                }
+
+                if (parent.json != nullptr && parent.json->contains(tokens.back())) {
+                    Value& current = (*parent.json)[tokens.back()];
+                    log.push_back({ Change::REPLACED, tokens, std::move(current) });
+                    current = std::move(value);
+                    rewrite(target, tokens, tracker);
+                    return true;
+                }
+
+                if (parent.list != nullptr) {
+                    size_t index = tokens.back() == "-" ? parent.list->size() : to_index(tokens.back());
+                    if (index > parent.list->size()) {
+                        return false;
+                    }
+                    tokens.back() = std::to_string(index);
+                }
+
+                put(parent, tokens.back(), std::move(value));
+                log.push_back({ Change::INSERTED, tokens });
+                rewrite(target, tokens, tracker);
+                return true;
+            }
+
+            bool take(JSON& target, const std::vector<std::string>& tokens, UndoLog& log, Tracker* tracker, bool moved = false) {
+                Parent parent;
+
+                if (!resolve(target, tokens, parent) || child(parent, tokens.back()) == nullptr) {
+                    return false;
+                }
+
+                log.push_back({ Change::TAKEN, tokens, remove(parent, tokens.back()), moved });
+                touch(target, tokens, tracker);
+                return true;
+            }
+
+            bool replace(JSON& target, const std::vector<std::string>& tokens, const Value& value, UndoLog& log, Tracker* tracker) {
+                Value* current = get(target, tokens);
+                if (current == nullptr) {
+                    return false;
+                }
+
+                log.push_back({ Change::REPLACED, tokens, std::move(*current) });
+                *current = value;
+                rewrite(target, tokens, tracker);
+                return true;
+            }
+
+            // a value put back is a new Value, the tracker learns about it like about an insert
+            void rollback(JSON& target, UndoLog& log, Tracker* tracker) {
+                Value carried; // value of a move on its way back to where it was taken from
+
+                for (auto it = log.rbegin(); it != log.rend(); it++) {
+                    Parent parent;
+                    resolve(target, it->tokens, parent);
+
+                    switch (it->change) {
+                        case Change::INSERTED: {
+                            carried = remove(parent, it->tokens.back());
+                            break;
+                        }
+
+                        case Change::TAKEN: {
+                            put(parent, it->tokens.back(), std::move(it->moved ? carried : it->previous));
+                            rewrite(target, it->tokens, tracker);
+                            break;
+                        }
+
+                        case Change::REPLACED: {
+                            Value* current = child(parent, it->tokens.back());
+                            carried = std::move(*current);
+                            *current = std::move(it->previous);
+                            break;
+                        }
+                    }
+                }
+
+                log.clear();
+            }
+
+            // returns true if target changed
+            bool merge_into(JSON& target, JSON& patch, Tracker* tracker) {
+                bool changed = false;
+
+                for (auto& it : patch) {
+                    Value& value = *it.second;
+
+                    if (value.type() == ValueType::NONE) {
+                        changed = target.erase(it.first) || changed;
+                        continue;
+                    }
+
+                    Value& current = target[it.first];
+
+                    if (value.type() == ValueType::JSON) {
+                        if (current.type() != ValueType::JSON) {
+                            current = ValuePair{ new JSON(), ValueType::JSON };
+                            changed = true;
+
+                            if (tracker != nullptr) {
+                                tracker->rewritten.insert(&current);
+                            }
+                        }
+
+                        changed = merge_into(current.value<JSON>(), value.value<JSON>(), tracker) || changed;
+                        continue;
+                    }
+
+                    current = value;
+                    changed = true;
+
+                    if (tracker != nullptr) {
+                        tracker->rewritten.insert(&current);
+                    }
+                }
+
+                if (changed && tracker != nullptr) {
+                    tracker->touched.insert(&target);
+                }
+
+                return changed;
+            }
+
+            bool apply_operation(JSON& target, PatchOperation& operation, UndoLog& log, Tracker* tracker) {
+                std::vector<std::string> path;
+                std::vector<std::string> from;
+
+                if (!split_pointer(operation.path, path) || !split_pointer(operation.from, from)) {
+                    return false;
+                }
+
+                switch (operation.op) {
+                    case Operation::ADD: {
+                        Value value;
+                        value = operation.value;
+                        return insert(target, path, std::move(value), log, tracker);
+                    }
+
+                    case Operation::REMOVE: {
+                        return take(target, path, log, tracker);
+                    }
+
+                    case Operation::REPLACE: {
+                        return replace(target, path, operation.value, log, tracker);
+                    }
+
+                    case Operation::MOVE: {
+                        if (path == from) {
+                            return get(target, from) != nullptr;
+                        }
+
+                        // a location can't be moved into one of its own children
+                        if (path.size() > from.size() && std::equal(from.begin(), from.end(), path.begin())) {
+                            return false;
+                        }
+
+                        if (!take(target, from, log, tracker, true)) {
+                            return false;
+                        }
+
+                        Value value = std::move(log.back().previous);
+                        if (!insert(target, path, std::move(value), log, tracker)) {
+                            // insert leaves the value alone when it fails, give it back to the taken entry
+                            log.back().previous = std::move(value);
+                            log.back().moved = false;
+                            return false;
+                        }
+
+                        return true;
+                    }
+
+                    case Operation::COPY: {
+                        Value* source = get(target, from);
+                        if (source == nullptr) {
+                            return false;
+                        }
+
+                        Value value;
+                        value = *source;
+                        return insert(target, path, std::move(value), log, tracker);
+                    }
+
+                    case Operation::TEST: {
+                        Value* value = get(target, path);
+                        return value != nullptr && equals(*value, operation.value);
+                    }
+                }
+
+                return false;
+            }
+
+            bool apply_tracked(JSON& target, std::vector<PatchOperation>& operations, Tracker* tracker) {
+                UndoLog log;
+
+                for (auto& operation : operations) {
+                    if (!apply_operation(target, operation, log, tracker)) {
+                        // the document is back as it was, only the values put back are new
+                        if (tracker != nullptr) {
+                            *tracker = Tracker();
+                        }
+
+                        rollback(target, log, tracker);
+                        return false;
+                    }
+                }
+
+                return true;
+            }
+        }
+
+        bool apply(JSON& target, std::vector<PatchOperation>& operations) {
+            return apply_tracked(target, operations, nullptr);
+        }
+
+        void merge(JSON& target, JSON& patch) {
+            merge_into(target, patch, nullptr);
+        }
+    }
+
+    namespace {
+        void skip_whitespace(std::string_view source, size_t& i) {
+            while (i < source.size() && (source[i] == ' ' || source[i] == '\t' || source[i] == '\n' || source[i] == '\r')) {
+                i++;
+            }
+        }
+
+        // i points at the opening quote, returns the raw text between the quotes
+        std::string_view skip_string(std::string_view source, size_t& i) {
+            size_t begin = ++i;
+
+            while (source[i] != '"') {
+                i += source[i] == '\\' ? 2 : 1;
+            }
+
+            return source.substr(begin, i++ - begin);
+        }
+    }
+
+    Document::Document(std::string filepath) {
+        if (filepath != "") {
+            this->load_from_file(filepath);
+        }
+    }
+
+    bool Document::load_from_file(std::string filepath) {
+        std::string content;
+
+        if (!read_file(filepath, content)) {
+            return false;
+        }
+
+        return this->load_from_string(std::move(content));
+    }
+
+    bool Document::load_from_string(std::string json_str) {
+        auto parsed = std::make_unique<JSON>();
+        if (!parsed->load_from_string(json_str)) {
+            return false;
+        }
+
+        this->m_source = std::move(json_str);
+        this->m_json = std::move(parsed);
+        this->m_spans.clear();
+        this->m_layouts.clear();
+        this->m_rewritten.clear();
+        this->m_touched.clear();
+
+        size_t i = 0;
+        skip_whitespace(this->m_source, i);
+        this->index(this->m_source, i, this->m_json.get());
+        return true;
+    }
+
+    // walks the source of a loaded value next to its tree, value is nullptr for text the tree
+    // doesn't hold (all but the last of repeated keys)
+    void Document::index(std::string_view source, size_t& i, Value* value) {
+        skip_whitespace(source, i);
+        size_t begin = i;
+
+        switch (source[i]) {
+            case '{': {
+                bool is_json = value != nullptr && value->type() == ValueType::JSON;
+                this->index(source, i, is_json ? &value->value<JSON>() : nullptr);
+                break;
+            }
+
+            case '[': {
+                bool is_list = value != nullptr && value->type() == ValueType::LIST;
+                this->index(source, i, is_list ? &value->value<List>() : nullptr);
+                break;
+            }
+
+            case '"': {
+                skip_string(source, i);
+                break;
+            }
+
+            default: {
+                while (i < source.size() && std::strchr(",]} \t\r\n", source[i]) == nullptr) {
+                    i++;
+                }
+            }
+        }
+
+        if (value != nullptr) {
+            this->m_spans[value] = { begin, i };
+        }
+    }
+
+    void Document::index(std::string_view source, size_t& i, JSON* json) {
+        Layout layout;
+        layout.text.begin = i++;
+        skip_whitespace(source, i);
+
+        while (source[i] != '}') {
+            Member member;
+            member.text.begin = i;
+            member.key = std::string(skip_string(source, i));
+            member.key_end = i;
+            skip_whitespace(source, i);
+            i++; // :
+            skip_whitespace(source, i);
+            member.value_begin = i;
+            member.value = json != nullptr && json->contains(member.key) ? &(*json)[member.key] : nullptr;
+
+            this->index(source, i, member.value);
+            member.text.end = i;
+            layout.members.push_back(std::move(member));
+
+            skip_whitespace(source, i);
+            if (source[i] == ',') {
+                i++;
+                skip_whitespace(source, i);
+            }
+        }
+
+        layout.text.end = ++i;
+
+        // the tree keeps the last of repeated keys
+        std::set<std::string> seen;
+        for (auto it = layout.members.rbegin(); it != layout.members.rend(); it++) {
+            if (!seen.insert(it->key).second) {
+                it->value = nullptr;
+            }
+        }
+
+        if (json != nullptr) {
+            this->m_layouts[json] = std::move(layout);
+        }
+    }
+
+    void Document::index(std::string_view source, size_t& i, List* list) {
+        Layout layout;
+        layout.text.begin = i++;
+        skip_whitespace(source, i);
+
+        for (size_t k = 0; source[i] != ']'; k++) {
+            Member member;
+            member.text.begin = member.key_end = member.value_begin = i;
+            member.value = list != nullptr && k < list->size() ? (*list)[k] : nullptr;
+
+            this->index(source, i, member.value);
+            member.text.end = i;
+            layout.members.push_back(std::move(member));
+
+            skip_whitespace(source, i);
+            if (source[i] == ',') {
+                i++;
+                skip_whitespace(source, i);
+            }
+        }
+
+        layout.text.end = ++i;
+
+        if (list != nullptr) {
+            this->m_layouts[list] = std::move(layout);
+        }
+    }
+
+    JSON& Document::json() {
+        return *this->m_json;
+    }
+
+    bool Document::apply(std::vector<patch::PatchOperation>& operations) {
+        patch::Tracker tracker;
+        bool applied = patch::apply_tracked(*this->m_json, operations, &tracker);
+
+        // a failed patch still leaves new values where it put back the ones it took
+        this->m_rewritten.insert(tracker.rewritten.begin(), tracker.rewritten.end());
+        this->m_touched.insert(tracker.touched.begin(), tracker.touched.end());
+        return applied;
+    }
+
+    void Document::merge(JSON& patch) {
+        patch::Tracker tracker;
+        patch::merge_into(*this->m_json, patch, &tracker);
+
+        this->m_rewritten.insert(tracker.rewritten.begin(), tracker.rewritten.end());
+        this->m_touched.insert(tracker.touched.begin(), tracker.touched.end());
+    }
+
+    void Document::write(std::ostream& os, Value& value) {
+        auto span = this->m_spans.find(&value);
+
+        if (span == this->m_spans.end() || this->m_rewritten.count(&value)) {
+            os << value;
+            return;
+        }
+
+        const void* container = nullptr;
+        if (value.type() == ValueType::JSON) {
+            container = &value.value<JSON>();
+        }
+        if (value.type() == ValueType::LIST) {
+            container = &value.value<List>();
+        }
+
+        if (container == nullptr || !this->m_touched.count(container)) {
+            os.write(this->m_source.data() + span->second.begin, span->second.end - span->second.begin);
+            return;
+        }
+
+        if (!this->m_layouts.count(container)) {
+            os << value;
+            return;
+        }
+
+        if (value.type() == ValueType::JSON) {
+            this->write(os, value.value<JSON>());
+        }
+        else {
+            this->write(os, value.value<List>());
+        }
+    }
+
+    void Document::write(std::ostream& os, JSON& json) {
+        const Layout& layout = this->m_layouts.at(&json);
+        std::vector<Entry> entries;
+        std::set<std::string> keys;
+
+        // members from the source keep their place, new ones go last
+        for (size_t k = 0; k < layout.members.size(); k++) {
+            const Member& member = layout.members[k];
+            keys.insert(member.key);
+
+            if (member.value != nullptr && json.contains(member.key)) {
+                entries.push_back({ k, &member.key, &json[member.key] });
+            }
+        }
+
+        for (auto& it : json) {
+            if (!keys.count(it.first)) {
+                entries.push_back({ std::string::npos, &it.first, it.second.get() });
+            }
+        }
+
+        this->write(os, layout, entries);
+    }
+
+    void Document::write(std::ostream& os, List& list) {
+        const Layout& layout = this->m_layouts.at(&list);
+        std::unordered_map<const Value*, size_t> members;
+        std::vector<Entry> entries;
+
+        for (size_t k = 0; k < layout.members.size(); k++) {
+            if (layout.members[k].value != nullptr) {
+                members[layout.members[k].value] = k;
+            }
+        }
+
+        for (Value* item : list) {
+            auto member = members.find(item);
+            entries.push_back({ member != members.end() ? member->second : std::string::npos, nullptr, item });
+        }
+
+        this->write(os, layout, entries);
+    }
+
+    void Document::write(std::ostream& os, const Layout& layout, std::vector<Entry>& entries) {
+        std::string_view source = this->m_source;
+        auto& members = layout.members;
+        size_t close = layout.text.end - 1;
+
+        auto text = [&](size_t begin, size_t end) {
+            return source.substr(begin, end - begin);
+        };
+
+        // whitespace inside the brackets
+        std::string_view leading = text(layout.text.begin + 1, members.empty() ? close : members.front().text.begin);
+        std::string_view trailing = members.empty() ? std::string_view() : text(members.back().text.end, close);
+
+        // new members are written like the last one in the source
+        std::string separator = ", ";
+        std::string colon = ": ";
+
+        if (members.size() > 1) {
+            separator = std::string(text(members[members.size() - 2].text.end, members.back().text.begin));
+        }
+        else if (!members.empty()) {
+            separator = "," + std::string(leading);
+        }
+
+        if (!members.empty()) {
+            colon = std::string(text(members.back().key_end, members.back().value_begin));
+        }
+
+        os << source[layout.text.begin] << leading;
+
+        for (size_t k = 0; k < entries.size(); k++) {
+            Entry& entry = entries[k];
+            bool from_source = entry.member != std::string::npos;
+
+            if (k > 0) {
+                // the source text after the member before it, it holds the comma
+                if (from_source && entry.member > 0) {
+                    os << text(members[entry.member - 1].text.end, members[entry.member].text.begin);
+                }
+                else {
+                    os << separator;
+                }
+            }
+
+            if (from_source) {
+                os << text(members[entry.member].text.begin, members[entry.member].value_begin);
+            }
+            else if (entry.key != nullptr) {
+                os << "\"" << *entry.key << "\"" << colon;
+            }
+
+            this->write(os, *entry.value);
+        }
+
+        os << trailing << source[close];
+    }
+
+    std::ostream& operator<<(std::ostream& os, Document& document) {
+        JSON& root = *document.m_json;
+
+        if (document.m_source.empty()) {
+            os << root;
+            return os;
+        }
+
+        if (!document.m_touched.count(&root)) {
+            os << document.m_source;
+            return os;
+        }
+
+        const Document::Span& text = document.m_layouts.at(&root).text;
+        os.write(document.m_source.data(), text.begin);
+        document.write(os, root);
+        os.write(document.m_source.data() + text.end, document.m_source.size() - text.end);
+        return os;
+    }
+
+    namespace parser {
+        struct SpecialTokens {
+            TokenType operator[](char key) {
+                switch (key) {
+                    case '(':  return TokenType::L_PAREN;
+                    case ')':  return TokenType::R_PAREN;
+                    case '{':  return TokenType::LC_BRACKET;
+                    case '}':  return TokenType::RC_BRACKET;
+                    case '[':  return TokenType::L_BRACKET;
+                    case ']':  return TokenType::R_BRACKET;
+                    case ':':  return TokenType::COLON;
+                    case ',':  return TokenType::COMMA;
+                    case '.':  return TokenType::DOT;
+                    case '\"': return TokenType::DOUBLE_QUOTE;
+                    default:   return TokenType::NONE;
+                }
+            }
+
+            bool is_special_char(char t) {
+                return (*this)[t] != TokenType::NONE;
+            }
+        };
+
+        std::vector<Token> Tokenize(std::string str) {
+            auto is_skippable = [](std::string& token, char t) -> bool {
+                return isspace(t) && !token.size();
+            };
+
+            std::vector<Token> tokens;
+            std::string token;
+
+            SpecialTokens special_tokens;
+            bool in_string = false;
+            bool escaped = false;
+
+            for (char t : str) {
+                // everything up to the closing quote is one word, \" doesn't close the string
+                if (in_string) {
+                    if (t == '"' && !escaped) {
+                        if (token.size() > 0) {
+                            tokens.push_back(Token(token, TokenType::WORD));
+                        }
+                        tokens.push_back(Token({ t }, TokenType::DOUBLE_QUOTE));
+
+                        token = "";
+                        in_string = false;
+                        continue;
+                    }
+
+                    escaped = !escaped && t == '\\';
+                    token += t;
+                    continue;
+                }
+
+                if (is_skippable(token, t)) {
+                    continue;
+                }
+
+                if (special_tokens.is_special_char(t)) {
+                    if (token.size() > 0) {
+                        tokens.push_back(Token(token, TokenType::WORD));
+                        tokens.push_back(Token({ t }, special_tokens[t]));
+                    }
+                    else {
+                        tokens.push_back(Token({ t }, special_tokens[t]));
+                    }
+
+                    in_string = t == '"';
+                    escaped = false;
+                    token = "";
+                    continue;
+                }
+
+                token += t;
+            }
+
+            return tokens;
+        }
+
+        size_t Lexer(std::vector<Token>& tokens, JSON& out_json) {
+            VectorView<Token> view = tokens;
+            return Lexer(view, out_json);
+        }
+
+        size_t Lexer(VectorView<Token>& tokens, JSON& out_json) {
+            size_t i = 0;
+
+#if DEBUG == 1
+            std::cout << "LEXER: " << out_json << std::endl;
+#endif
+
+            auto check_token = [&](Token& token)-> bool {
+                return 
+                    token.type == TokenType::DOUBLE_QUOTE // check if this is not string structure
+                    && (
+                        i == 0 // if starting point, this is true
+                        || (i > 0) // if this is value
+                        && tokens[i - 1].type != TokenType::COLON // check not : because this is must be a value
+                    );
+            };
+
+            auto parseInnerJson = [&](size_t inner_index) -> PtrJson {
+                std::unique_ptr<JSON> parsed_json = std::make_unique<JSON>();
+                VectorView<Token> view(tokens, inner_index);
+
+                // recurcive (((
+                i += Lexer(view, *parsed_json);
+                return parsed_json.release();
+            };
+
+            auto parseStr = [&]()-> std::string* {
+                std::string temp_str;
+                ++i; // consume first quote
+
+                for (Token token = tokens[i]; token.type != TokenType::DOUBLE_QUOTE; token = tokens[++i]) {
+                    temp_str += token.value;
+                }
+
+                std::string* str = new std::string(temp_str);
+                ++i; // consume last quote
+                return str;
+            };
+
+            auto parseValue = [&](Value& v) -> Value* {
+                std::string possible_value;
+
+                for (
+                    Token token = tokens[i];
+                    (
+                        token.type != TokenType::COMMA
+                        && token.type != TokenType::RC_BRACKET
+                        && token.type != TokenType::R_BRACKET
+                    );
+                    token = tokens[++i]
+                ) {
+                    possible_value += token.value;
+                }
+
+                trim(possible_value);
+                const char* first = possible_value.data();
+                const char* last = first + possible_value.size();
+
+                // true, false, null, a list inside a list or a number out of range
+                auto unsupported = [&](std::from_chars_result result) {
+                    if (result.ec != std::errc() || result.ptr != last) {
+                        throw UnsupportedValue(possible_value);
+                    }
+                };
+
+                if (possible_value.find_first_of(".eE") != std::string::npos) {
+                    double value = 0;
+                    unsupported(std::from_chars(first, last, value));
+                    v = ValuePair{ new double(value), ValueType::DOUBLE };
+                }
+                else {
+                    int value = 0;
+                    unsupported(std::from_chars(first, last, value));
+                    v = ValuePair{ new int(value), ValueType::INTEGER };
+                }
+
+                return &v;
+            };
+
+            while (i < tokens.size()) {
+                Token token = tokens[i];
+
+                if (token.type == TokenType::LC_BRACKET) {
+                    i++;
+                    continue;
+                }
+
+                if (token.type == TokenType::RC_BRACKET) {
+                    i++;
+                    break;
+                }
+
+                if (!check_token(token))
+                {
+                    i++;
+                    continue;
+                }
+                
+                i++;
+                token = tokens[i];
+                std::string key;
+
+                if (token.type != TokenType::DOUBLE_QUOTE) { // "" has no key token
+                    key = token.value;
+                }
+
+                while (i < tokens.size() && tokens[i].type != TokenType::COLON) { // token<key>, token<">, token<:> and than continues
+                    i++;
+                }
+
+                if (i + 1 >= tokens.size()) {
+                    break;
+                }
+
+                i++;
+                token = tokens[i];
+
+                switch (token.type) {
+                    case TokenType::LC_BRACKET: { // parse inner json
+                        out_json[key] = ValuePair{ parseInnerJson(i), ValueType::JSON };
+                        continue;
+                    }
+
+                    case TokenType::DOUBLE_QUOTE: {
+                        out_json[key] = ValuePair{ parseStr(), ValueType::STRING };
+                        token = tokens[i];
+                        continue;
+                    }
+
+                    case TokenType::L_BRACKET: {
+                        Value list_value(new List(), ValueType::LIST); // frees the items if parsing throws
+                        PtrList list = &list_value.value<List>();
+                        i++;
+                        token = tokens[i];
+                        std::string temp_str;
+
+                        while (token.type != TokenType::R_BRACKET)
+                        {
+                            switch (token.type)
+                            {
+                                case TokenType::DOUBLE_QUOTE: {
+                                    list->push_back(
+                                        new Value(
+                                            parseStr(),
+                                            ValueType::STRING
+                                        )
+                                    );
+                                    token = tokens[i];
+                                    continue;
+                                }
+
+                                case TokenType::LC_BRACKET: { // parse inner json in list
+                                    auto parsed_json = parseInnerJson(i);
+#if DEBUG == 1
+                                    std::cout << *parsed_json << std::endl;
+#endif
 
                                     list->push_back(
                                         new Value(
@@ -497,8 +2320,11 @@ namespace json {
 
                                 default: {
                                     if (token.type != TokenType::COMMA) {
-                                        Value* v = parseValue(*(new Value()));
-                                        list->push_back(v);
+                                        auto v = std::make_unique<Value>();
+                                        parseValue(*v);
+                                        list->push_back(v.release());
+                                        token = tokens[i]; // parseValue stops at , or ] which is checked by the loop
+                                        continue;
                                     }
                                     break;
                                 }
@@ -508,7 +2334,7 @@ namespace json {
                             token = tokens[i];
                         }
 
-                        out_json[key] = ValuePair{ list, ValueType::LIST };
+                        out_json[key] = std::move(list_value);
                         i++;
                         continue;
                     }
@@ -2,9 +2,13 @@
 #define __JSON__
 
 #include <unordered_map>
+#include <set>
 #include <vector>
 #include <memory>
 #include <string>
+#include <string_view>
+#include <future>
+#include <thread>
 
 namespace {
     std::string& ltrim(std::string& str, const std::string& chars = "\t\n\v\f\r ");
@@ -102,6 +106,7 @@ namespace json {
         ~Value();
 
         Value& operator=(const Value& other);
+        Value& operator=(Value&& other) noexcept;
         Value& operator=(const Value* other);
         Value& operator=(const ValuePair& other);
 
@@ -125,8 +130,8 @@ namespace json {
         void set(void* value, ValueType type);
 
     private:
-        void* m_value;
-        ValueType m_type;
+        void* m_value = nullptr;
+        ValueType m_type = ValueType::NONE;
     };
 
     using List = std::vector<Value*>;
@@ -140,10 +145,15 @@ namespace json {
 
         JSON(std::string filepath="");
         bool load_from_file(std::string filepath);
+        // false if json_str is not a JSON object (see validate) or holds a value the tree can't:
+        // true, false, null, a list inside a list, an integer out of int or a number out of double range
         bool load_from_string(std::string json_str);
         
         Value& operator[](const std::string str);
 
+        bool contains(const std::string& key) const;
+        bool erase(const std::string& key);
+
         friend std::ostream& operator<<(std::ostream& os, JSON& value);
 
         JsonStore::iterator begin() {
@@ -168,6 +178,178 @@ namespace json {
     };
 
     using PtrJson = JSON*;
+    using JsonFuture = std::future<std::unique_ptr<JSON>>;
+
+    // Loads a batch of files while `workers` threads parse the buffers already read. On Linux one
+    // thread keeps many reads in flight through io_uring, without it (or with io_uring = false)
+    // a few threads read with blocking calls. At most 2 * workers read buffers wait for a parser.
+    // A future holds nullptr if its file can't be read or JSON::load_from_string rejects it,
+    // and the exception if the parser throws.
+    // Destroying the loader skips files that are not read yet and joins its threads,
+    // futures of the skipped files report std::future_errc::broken_promise.
+    class BatchLoader {
+    public:
+        BatchLoader(const std::vector<std::string>& filepaths, size_t workers = 0, bool io_uring = true);
+
+        BatchLoader(const BatchLoader&) = delete;
+        BatchLoader& operator=(const BatchLoader&) = delete;
+
+        ~BatchLoader();
+
+        JsonFuture& operator[](size_t i) {
+            return this->m_futures[i];
+        }
+
+        size_t size() const {
+            return this->m_futures.size();
+        }
+
+        std::vector<JsonFuture>::iterator begin() {
+            return this->m_futures.begin();
+        }
+
+        std::vector<JsonFuture>::iterator end() {
+            return this->m_futures.end();
+        }
+
+    private:
+        struct Queue;
+
+        void stop();
+
+        std::unique_ptr<Queue> m_queue;
+        std::vector<JsonFuture> m_futures;
+        std::vector<std::thread> m_threads;
+    };
+
+    BatchLoader load_from_files(const std::vector<std::string>& filepaths, size_t workers = 0);
+
+    // Structural equality: same types and values, objects compared regardless of key order.
+    bool equals(Value& left, Value& right);
+    bool equals(JSON& left, JSON& right);
+
+    enum class ValidationError {
+        NONE,
+        UNEXPECTED_END,
+        UNEXPECTED_CHARACTER,
+        INVALID_NUMBER,
+        INVALID_STRING, // raw control character inside a string
+        INVALID_ESCAPE,
+        INVALID_UTF8,
+        DEPTH_EXCEEDED,
+        TRAILING_CHARACTERS
+    };
+
+    struct ValidationResult {
+    public:
+        ValidationError error = ValidationError::NONE;
+        size_t position = 0; // byte offset of the first offending character
+
+        explicit operator bool() const {
+            return this->error == ValidationError::NONE;
+        }
+    };
+
+    constexpr size_t VALIDATION_MAX_DEPTH = 1024;
+
+    // Checks that str is well-formed JSON (RFC 8259) with valid UTF-8 without building a tree
+    // and without allocating. Nesting deeper than VALIDATION_MAX_DEPTH is reported as an error.
+    ValidationResult validate(std::string_view str);
+
+    namespace patch {
+        enum class Operation {
+            ADD,
+            REMOVE,
+            REPLACE,
+            MOVE,
+            COPY,
+            TEST
+        };
+
+        struct PatchOperation {
+        public:
+            PatchOperation(Operation op, std::string path, std::string from = "", Value value = Value()) :
+                op(op), path(std::move(path)), from(std::move(from)), value(std::move(value))
+            {
+            }
+
+            Operation op;
+            std::string path; // JSON Pointer, e.g. /dict/list/0
+            std::string from; // used only by MOVE and COPY
+            Value value; // used only by ADD, REPLACE and TEST
+        };
+
+        // escapes ~ and / of an object key for use in a JSON Pointer (RFC 6901)
+        std::string escape_token(const std::string& token);
+
+        // JSON Patch (RFC 6902). Operations are applied in order, if one of them fails the ones
+        // before it are reverted, target is left as it was and false is returned.
+        bool apply(JSON& target, std::vector<PatchOperation>& operations);
+
+        // JSON Merge Patch (RFC 7396). NONE values in the patch remove keys from the target.
+        void merge(JSON& target, JSON& patch);
+    }
+
+    // Keeps the source text of a document next to its tree. Changes made through apply and merge
+    // are tracked and operator<< serializes only the changed values: everything else, the text
+    // between members included, is copied from the source. Members added to an object go after
+    // its last member. Edits made directly through json() are not tracked.
+    class Document {
+    public:
+        Document(std::string filepath = "");
+        bool load_from_file(std::string filepath);
+        bool load_from_string(std::string json_str);
+
+        JSON& json();
+
+        bool apply(std::vector<patch::PatchOperation>& operations);
+        void merge(JSON& patch);
+
+        friend std::ostream& operator<<(std::ostream& os, Document& document);
+
+    private:
+        struct Span {
+            size_t begin;
+            size_t end;
+        };
+
+        // an object member or a list item as it is in the source
+        struct Member {
+            std::string key; // raw text between the quotes, objects only
+            Span text; // from the key (the value in a list) to the end of the value
+            size_t key_end; // one past the closing quote of the key
+            size_t value_begin;
+            Value* value; // nullptr if a later member has the same key
+        };
+
+        struct Layout {
+            Span text; // from the opening to one past the closing bracket
+            std::vector<Member> members;
+        };
+
+        // what operator<< writes for a container: a source member, a new one or both
+        struct Entry {
+            size_t member; // index in Layout::members, npos for a new member
+            const std::string* key; // objects only
+            Value* value;
+        };
+
+        void index(std::string_view source, size_t& i, Value* value);
+        void index(std::string_view source, size_t& i, JSON* json);
+        void index(std::string_view source, size_t& i, List* list);
+
+        void write(std::ostream& os, Value& value);
+        void write(std::ostream& os, JSON& json);
+        void write(std::ostream& os, List& list);
+        void write(std::ostream& os, const Layout& layout, std::vector<Entry>& entries);
+
+        std::string m_source;
+        std::unique_ptr<JSON> m_json = std::make_unique<JSON>();
+        std::unordered_map<const Value*, Span> m_spans; // source bytes of every loaded value
+        std::unordered_map<const void*, Layout> m_layouts; // JSON or List -> its source members
+        std::set<const Value*> m_rewritten; // values set by apply or merge, they have no source text
+        std::set<const void*> m_touched; // JSON or List with a changed value somewhere inside
+    };
 
     namespace parser {
         enum class TokenType {
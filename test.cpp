@@ -0,0 +1,331 @@
+#include <iostream>
+#include <string>
+#include <sstream>
+#include "json/json.h"
+
+namespace {
+    int failures = 0;
+
+    void check(bool condition, const std::string& name) {
+        if (!condition) {
+            std::cout << "FAIL: " << name << std::endl;
+            failures++;
+        }
+    }
+
+    bool is_line_breaks_json(json::JSON& json) {
+        if (json["l"].type() != json::ValueType::LIST || json["b"].type() != json::ValueType::INTEGER) {
+            return false;
+        }
+
+        auto& list = json["l"].value<json::List>();
+        return (
+            list.size() == 1
+            && list[0]->type() == json::ValueType::STRING
+            && list[0]->value<std::string>() == "a"
+            && json["b"].value<int>() == 2
+        );
+    }
+
+    void test_load_from_file() {
+        json::JSON json;
+        check(json.load_from_file("./resources/line_breaks.json"), "load_from_file: line breaks after a string");
+        check(is_line_breaks_json(json), "load_from_file: line breaks after a string, content");
+
+        json::JSON missing;
+        check(!missing.load_from_file("./resources"), "load_from_file: directory");
+    }
+
+    void test_load_from_files() {
+        std::vector<std::string> filepaths = {
+            "./resources/line_breaks.json", "./resources", "./resources/missing.json", "./resources/invalid.json"
+        };
+
+        for (bool io_uring : { true, false }) {
+            std::string name = io_uring ? "load_from_files: " : "load_from_files, blocking reads: ";
+            json::BatchLoader loader(filepaths, 2, io_uring);
+            check(loader.size() == 4, name + "future per file");
+
+            auto parsed = loader[0].get();
+            check(parsed != nullptr && is_line_breaks_json(*parsed), name + "line breaks after a string");
+            check(loader[1].get() == nullptr, name + "directory");
+            check(loader[2].get() == nullptr, name + "missing file");
+            check(loader[3].get() == nullptr, name + "invalid json");
+
+            // more files than the queue holds, destroyed before the parser got to most of them
+            json::BatchLoader many(std::vector<std::string>(500, "./resources/line_breaks.json"), 1, io_uring);
+            parsed = many[0].get();
+            check(parsed != nullptr && is_line_breaks_json(*parsed), name + "many files");
+        }
+    }
+
+    void test_validate() {
+        using json::ValidationError;
+
+        struct Case {
+            std::string input;
+            ValidationError error;
+            size_t position;
+        };
+
+        std::vector<Case> cases = {
+            { "{}", ValidationError::NONE, 0 },
+            { " [1, -0.5e+3, \"\\u00e9\xc3\xa9\", true, false, null, {\"a\": []}] ", ValidationError::NONE, 0 },
+            { "", ValidationError::UNEXPECTED_END, 0 },
+            { "{\"a\": [1, 2", ValidationError::UNEXPECTED_END, 11 },
+            { "{\"a\": 1,}", ValidationError::UNEXPECTED_CHARACTER, 8 },
+            { "[1 2]", ValidationError::UNEXPECTED_CHARACTER, 3 },
+            { "{\"a\" 1}", ValidationError::UNEXPECTED_CHARACTER, 5 },
+            { "[tru]", ValidationError::UNEXPECTED_CHARACTER, 1 },
+            { "[01]", ValidationError::UNEXPECTED_CHARACTER, 2 },
+            { "[1.]", ValidationError::INVALID_NUMBER, 3 },
+            { "[1.5e]", ValidationError::INVALID_NUMBER, 5 },
+            { "[-x]", ValidationError::INVALID_NUMBER, 2 },
+            { "[\"a\x01\"]", ValidationError::INVALID_STRING, 3 },
+            { "[\"\\x\"]", ValidationError::INVALID_ESCAPE, 2 },
+            { "[\"\\u12g4\"]", ValidationError::INVALID_ESCAPE, 2 },
+            { "[\"\xc0\xaf\"]", ValidationError::INVALID_UTF8, 2 },
+            { "[\"\xe0\x80\xaf\"]", ValidationError::INVALID_UTF8, 2 },
+            { "[\"\xed\xa0\x80\"]", ValidationError::INVALID_UTF8, 2 },
+            { "[\"\xf4\x90\x80\x80\"]", ValidationError::INVALID_UTF8, 2 },
+            { "[\"\xe2\x82\"]", ValidationError::INVALID_UTF8, 2 },
+            { "{}}", ValidationError::TRAILING_CHARACTERS, 2 },
+            { std::string(json::VALIDATION_MAX_DEPTH, '[') + std::string(json::VALIDATION_MAX_DEPTH, ']'), ValidationError::NONE, 0 },
+            { std::string(json::VALIDATION_MAX_DEPTH + 1, '['), ValidationError::DEPTH_EXCEEDED, json::VALIDATION_MAX_DEPTH },
+        };
+
+        for (auto& test : cases) {
+            auto result = json::validate(test.input);
+            check(
+                result.error == test.error && result.position == test.position,
+                "validate: " + test.input.substr(0, 32) + " -> " + std::to_string(static_cast<int>(result.error))
+                    + "@" + std::to_string(result.position)
+            );
+        }
+
+        json::JSON garbage;
+        check(!garbage.load_from_string("{\"a\": garbage"), "load_from_string: invalid json");
+    }
+
+    void test_parser() {
+        json::JSON json;
+        check(json.load_from_string("{\"l\": [\"a\" , 1, 2.5], \"\": \"one, two: {three}\", \"q\\\"k\": \"x\\\"y\", \"e\": 1.5e2}"), "parser: load");
+
+        auto& list = json["l"].value<json::List>();
+        check(list.size() == 3 && list[2]->type() == json::ValueType::DOUBLE, "parser: list ending with a number");
+        check(list[0]->value<std::string>() == "a", "parser: whitespace after a string in a list");
+        check(json[""].value<std::string>() == "one, two: {three}", "parser: empty key, special characters in a string");
+        check(json.contains("q\\\"k") && json["q\\\"k"].value<std::string>() == "x\\\"y", "parser: escaped quotes");
+        check(json["e"].type() == json::ValueType::DOUBLE && json["e"].value<double>() == 150, "parser: exponent");
+
+        const char* unsupported[] = {
+            "[1, 2]",
+            "\"text\"",
+            "{\"a\": true}",
+            "{\"a\": [null]}",
+            "{\"a\": [[1], 2]}",
+            "{\"a\": 2147483648}",
+            "{\"a\": 1e400}",
+        };
+
+        for (auto text : unsupported) {
+            json::JSON rejected;
+            check(!rejected.load_from_string(text), std::string("parser: rejects ") + text);
+        }
+
+        json::JSON doubles;
+        doubles.load_from_string("{\"d\": 0.1, \"w\": 3.0}");
+        std::stringstream written;
+        written << doubles["d"] << " " << doubles["w"];
+        check(written.str() == "0.1 3.0", "parser: doubles are written in the shortest form that reads back");
+
+        json::JSON kept;
+        kept.load_from_string("{\"k\": 1}");
+        check(!kept.load_from_string("{\"a\": 1, \"b\": false}") && !kept.contains("a"), "parser: rejected input leaves the object alone");
+    }
+
+    json::Value integer(int value) {
+        return json::Value(new int(value), json::ValueType::INTEGER);
+    }
+
+    void test_patch_pointers() {
+        using namespace json::patch;
+
+        json::JSON json;
+        json.load_from_string("{\"l\": [\"x\", \"y\"], \"a/b\": 1, \"m~n\": 2}");
+
+        std::vector<PatchOperation> overflow;
+        overflow.push_back({ Operation::REMOVE, "/l/99999999999999999999999" });
+        check(!apply(json, overflow), "patch: index overflow");
+
+        std::vector<PatchOperation> leading_zero;
+        leading_zero.push_back({ Operation::REMOVE, "/l/01" });
+        check(!apply(json, leading_zero), "patch: index with leading zero");
+
+        std::vector<PatchOperation> relative;
+        relative.push_back({ Operation::REMOVE, "l/0" });
+        check(!apply(json, relative), "patch: pointer without leading /");
+
+        std::vector<PatchOperation> bad_escape;
+        bad_escape.push_back({ Operation::REMOVE, "/m~xn" });
+        check(!apply(json, bad_escape), "patch: ~ followed by something other than 0 or 1");
+
+        std::vector<PatchOperation> escapes;
+        escapes.push_back({ Operation::REMOVE, "/a~1b" });
+        escapes.push_back({ Operation::REMOVE, "/m~0n" });
+        escapes.push_back({ Operation::REMOVE, "/l/-" });
+        check(!apply(json, escapes), "patch: - is not an existing index");
+        check(json.contains("a/b") && json.contains("m~n"), "patch: failed patch keeps earlier operations reverted");
+
+        escapes.pop_back();
+        check(apply(json, escapes) && !json.contains("a/b") && !json.contains("m~n"), "patch: escaped keys");
+    }
+
+    void test_patch_atomic() {
+        using namespace json::patch;
+
+        json::JSON json;
+        std::string source = "{\"a\": 1, \"l\": [\"x\", \"y\", \"z\"], \"o\": {\"x\": 1}}";
+        json.load_from_string(source);
+
+        json::JSON before;
+        before.load_from_string(source);
+
+        std::vector<PatchOperation> operations;
+        operations.push_back({ Operation::REMOVE, "/a" });
+        operations.push_back({ Operation::ADD, "/l/1", "", integer(7) });
+        operations.push_back({ Operation::ADD, "/o/x", "", integer(8) });
+        operations.push_back({ Operation::MOVE, "/o/y", "/l/0" });
+        operations.push_back({ Operation::MOVE, "/moved", "/o" });
+        operations.push_back({ Operation::COPY, "/l/-", "/moved" });
+        operations.push_back({ Operation::REPLACE, "/l/0", "", integer(9) });
+        operations.push_back({ Operation::REMOVE, "/missing" });
+
+        check(!apply(json, operations), "patch: failing operation fails the patch");
+        check(json::equals(json, before), "patch: failed patch leaves the document unchanged");
+
+        operations.pop_back();
+        check(apply(json, operations), "patch: batch applies");
+        check(!json.contains("a") && !json.contains("o") && json.contains("moved"), "patch: batch result keys");
+        check(json["l"].value<json::List>().size() == 4, "patch: batch result list");
+
+        json::JSON moved;
+        moved.load_from_string(source);
+
+        std::vector<PatchOperation> failing_move;
+        failing_move.push_back({ Operation::REMOVE, "/a" });
+        failing_move.push_back({ Operation::MOVE, "/missing/x", "/o" });
+
+        check(!apply(moved, failing_move), "patch: move to a missing parent fails");
+        check(json::equals(moved, before), "patch: failed move keeps the moved value");
+    }
+
+    std::string dump(json::Document& document) {
+        std::stringstream ss;
+        ss << document;
+        return ss.str();
+    }
+
+    void test_document() {
+        using namespace json::patch;
+
+        std::string source =
+            "{\n"
+            "  \"name\":   \"keep   spacing\",\n"
+            "  \"nested\": {\"count\": 1,  \"pi\": 3.14159265358979,  \"list\": [\"a\",  \"b\",  0.1]},\n"
+            "  \"other\":  {\"x\": 2}\n"
+            "}";
+
+        json::Document document;
+        check(document.load_from_string(source), "document: load");
+        check(dump(document) == source, "document: unchanged document is written as loaded");
+
+        std::vector<PatchOperation> replace;
+        replace.push_back({ Operation::REPLACE, "/nested/count", "", integer(5) });
+        check(document.apply(replace), "document: replace");
+        check(
+            dump(document) ==
+                "{\n"
+                "  \"name\":   \"keep   spacing\",\n"
+                "  \"nested\": {\"count\": 5,  \"pi\": 3.14159265358979,  \"list\": [\"a\",  \"b\",  0.1]},\n"
+                "  \"other\":  {\"x\": 2}\n"
+                "}",
+            "document: only the replaced value is serialized"
+        );
+
+        std::vector<PatchOperation> list;
+        list.push_back({ Operation::REMOVE, "/nested/list/0" });
+        list.push_back({ Operation::ADD, "/nested/list/-", "", integer(3) });
+        check(document.apply(list), "document: remove and append");
+        check(
+            dump(document) ==
+                "{\n"
+                "  \"name\":   \"keep   spacing\",\n"
+                "  \"nested\": {\"count\": 5,  \"pi\": 3.14159265358979,  \"list\": [\"b\",  0.1,  3]},\n"
+                "  \"other\":  {\"x\": 2}\n"
+                "}",
+            "document: list items keep their source text"
+        );
+
+        std::vector<PatchOperation> failing;
+        failing.push_back({ Operation::REPLACE, "/other/x", "", integer(3) });
+        failing.push_back({ Operation::REMOVE, "/missing" });
+        check(!document.apply(failing), "document: failing patch");
+        check(dump(document).find("\"other\":  {\"x\": 2}") != std::string::npos, "document: failing patch marks nothing");
+
+        json::JSON patch;
+        patch.load_from_string("{\"other\": {\"x\": 4}}");
+        document.merge(patch);
+        check(
+            dump(document) ==
+                "{\n"
+                "  \"name\":   \"keep   spacing\",\n"
+                "  \"nested\": {\"count\": 5,  \"pi\": 3.14159265358979,  \"list\": [\"b\",  0.1,  3]},\n"
+                "  \"other\":  {\"x\": 4}\n"
+                "}",
+            "document: merge"
+        );
+
+        std::vector<PatchOperation> root;
+        root.push_back({ Operation::ADD, "/added", "", integer(1) });
+        root.push_back({ Operation::REMOVE, "/name" });
+        check(document.apply(root), "document: add and remove at the root");
+        check(
+            dump(document) ==
+                "{\n"
+                "  \"nested\": {\"count\": 5,  \"pi\": 3.14159265358979,  \"list\": [\"b\",  0.1,  3]},\n"
+                "  \"other\":  {\"x\": 4},\n"
+                "  \"added\":  1\n"
+                "}",
+            "document: root members keep their source text"
+        );
+
+        std::string before = dump(document);
+        std::vector<PatchOperation> failing_move;
+        failing_move.push_back({ Operation::MOVE, "/missing/x", "/other" });
+        check(!document.apply(failing_move) && dump(document) == before, "document: failing move");
+
+        json::JSON reloaded;
+        check(reloaded.load_from_string(dump(document)) && json::equals(reloaded, document.json()), "document: output parses to the tree");
+
+        check(!document.load_from_string("[1]") && dump(document) == before, "document: rejected source keeps the document");
+    }
+}
+
+int main() {
+    test_validate();
+    test_parser();
+    test_load_from_file();
+    test_load_from_files();
+    test_patch_pointers();
+    test_patch_atomic();
+    test_document();
+
+    if (failures) {
+        std::cout << failures << " CHECKS FAILED" << std::endl;
+        return 1;
+    }
+
+    std::cout << "ALL CHECKS PASSED" << std::endl;
+    return 0;
+}